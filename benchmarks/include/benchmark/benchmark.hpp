@@ -0,0 +1,67 @@
+/* benchmark.hpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: Fabian Meyer
+ */
+
+#ifndef ADCPP_BENCHMARK_HPP_
+#define ADCPP_BENCHMARK_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+    /// @brief Heap statistics which are collected by the replaced global
+    /// operator new and operator delete.
+    struct Allocations
+    {
+        std::atomic<std::size_t> count;
+        std::atomic<std::size_t> bytes;
+        std::atomic<std::size_t> live;
+        std::atomic<std::size_t> peak;
+
+        /// @brief Returns the process wide heap statistics.
+        static Allocations &instance();
+    };
+
+    /// @brief Function which runs one evaluation of a workload and returns a
+    /// value depending on its result, so the evaluation cannot be optimized
+    /// away.
+    typedef double (*Function)();
+
+    struct Benchmark
+    {
+        std::string name;
+        Function function;
+    };
+
+    /// @brief Returns all benchmarks registered by ADCPP_BENCHMARK.
+    inline std::vector<Benchmark> &registry()
+    {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct Registrar
+    {
+        Registrar(const char *name, const Function function)
+        {
+            registry().push_back({name, function});
+        }
+    };
+}
+
+#define ADCPP_BENCHMARK_CONCAT_(a, b) a ## b
+#define ADCPP_BENCHMARK_CONCAT(a, b) ADCPP_BENCHMARK_CONCAT_(a, b)
+
+/// Defines and registers a benchmark function with the given name.
+#define ADCPP_BENCHMARK(name)                                                 \
+    static double ADCPP_BENCHMARK_CONCAT(benchmark_, __LINE__)();             \
+    static const benchmark::Registrar ADCPP_BENCHMARK_CONCAT(registrar_, __LINE__)( \
+        name, &ADCPP_BENCHMARK_CONCAT(benchmark_, __LINE__));                 \
+    static double ADCPP_BENCHMARK_CONCAT(benchmark_, __LINE__)()
+
+#endif
@@ -0,0 +1,288 @@
+/* adcpp_backward.bench.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: Fabian Meyer
+ */
+
+#include <benchmark/benchmark.hpp>
+#include <adcpp/adcpp_eigen.hpp>
+#include <vector>
+
+using namespace adcpp;
+
+static bwd::Double recurse(const bwd::Double &x, const int depth)
+{
+    if(depth == 0)
+        return x;
+    return bwd::cos(recurse(x, depth - 1)) + x * bwd::Double(0.5);
+}
+
+ADCPP_BENCHMARK("backward/scalar chain")
+{
+    const bwd::Double x(0.5);
+    bwd::Double f = x;
+    for(int i = 0; i < 100; ++i)
+        f = bwd::sin(f) * bwd::Double(1.1) + bwd::exp(-f) / bwd::Double(3);
+
+    bwd::Double::DerivativeMap derivative;
+    f.derivative(derivative);
+    return f.value() + derivative(x);
+}
+
+ADCPP_BENCHMARK("backward/wide sum")
+{
+    bwd::VectorXd x(1000);
+    for(long int i = 0; i < x.size(); ++i)
+        x(i) = bwd::Double(0.001 * i);
+
+    bwd::Double f(0);
+    for(long int i = 0; i < x.size(); ++i)
+        f = f + bwd::sin(x(i));
+
+    Eigen::VectorXd grad(x.size());
+    bwd::gradient(x, f, grad);
+    return f.value() + grad(999);
+}
+
+ADCPP_BENCHMARK("backward/dot product")
+{
+    bwd::VectorXd x(1000);
+    bwd::VectorXd y(1000);
+    for(long int i = 0; i < x.size(); ++i)
+    {
+        x(i) = bwd::Double(0.001 * i);
+        y(i) = bwd::Double(1 - 0.001 * i);
+    }
+
+    bwd::Double f = x.dot(y) + x.squaredNorm();
+
+    Eigen::VectorXd grad(x.size());
+    bwd::gradient(x, f, grad);
+    return f.value() + grad(999);
+}
+
+ADCPP_BENCHMARK("backward/deep recursion")
+{
+    const bwd::Double x(0.5);
+    const auto f = recurse(x, 1000);
+
+    bwd::Double::DerivativeMap derivative;
+    f.derivative(derivative);
+    return f.value() + derivative(x);
+}
+
+ADCPP_BENCHMARK("backward/rosenbrock gradient")
+{
+    bwd::VectorXd x(100);
+    for(long int i = 0; i < x.size(); ++i)
+        x(i) = bwd::Double(0.01 * i);
+
+    bwd::Double f(0);
+    for(long int i = 0; i + 1 < x.size(); ++i)
+    {
+        const auto a = x(i + 1) - x(i) * x(i);
+        const auto b = bwd::Double(1) - x(i);
+        f = f + bwd::Double(100) * a * a + b * b;
+    }
+
+    Eigen::VectorXd grad(x.size());
+    bwd::gradient(x, f, grad);
+    return f.value() + grad(99);
+}
+
+ADCPP_BENCHMARK("backward/rosenbrock hessian vector product")
+{
+    bwd::VectorXd x(100);
+    for(long int i = 0; i < x.size(); ++i)
+        x(i) = bwd::Double(0.01 * i);
+
+    bwd::Double f(0);
+    for(long int i = 0; i + 1 < x.size(); ++i)
+    {
+        const auto a = x(i + 1) - x(i) * x(i);
+        const auto b = bwd::Double(1) - x(i);
+        f = f + bwd::Double(100) * a * a + b * b;
+    }
+
+    const Eigen::VectorXd v = Eigen::VectorXd::Ones(x.size());
+    Eigen::VectorXd hv(x.size());
+    bwd::hessianVectorProduct(x, f, v, hv);
+    return f.value() + hv(99);
+}
+
+ADCPP_BENCHMARK("backward/rosenbrock hessian")
+{
+    bwd::VectorXd x(100);
+    for(long int i = 0; i < x.size(); ++i)
+        x(i) = bwd::Double(0.01 * i);
+
+    bwd::Double f(0);
+    for(long int i = 0; i + 1 < x.size(); ++i)
+    {
+        const auto a = x(i + 1) - x(i) * x(i);
+        const auto b = bwd::Double(1) - x(i);
+        f = f + bwd::Double(100) * a * a + b * b;
+    }
+
+    Eigen::SparseMatrix<double> hes;
+    bwd::hessian(x, f, hes);
+    return f.value() + hes.coeff(99, 98);
+}
+
+/// Polynomial of degree 31 evaluated by Horner's scheme, whose derivative
+/// is accumulated along with its value.
+static void polynomialKernel(const double *x, double *y, double *jacobian)
+{
+    double value = 0;
+    double derivative = 0;
+    for(int k = 31; k >= 0; --k)
+    {
+        derivative = derivative * x[0] + value;
+        value = value * x[0] + 1.0 / (k + 1);
+    }
+    y[0] = value * x[1];
+    jacobian[0] = derivative * x[1];
+    jacobian[1] = value;
+}
+
+ADCPP_BENCHMARK("backward/polynomial kernel traced")
+{
+    bwd::Double a(0.1), b(0.2);
+    bwd::Double f(0);
+    for(int i = 0; i < 100; ++i)
+    {
+        bwd::Double value(0);
+        for(int k = 31; k >= 0; --k)
+            value = value * a + bwd::Double(1.0 / (k + 1));
+        f = f + value * b;
+    }
+
+    bwd::Double::DerivativeMap derivative;
+    f.derivative(derivative);
+    return derivative(a);
+}
+
+ADCPP_BENCHMARK("backward/polynomial kernel custom")
+{
+    bwd::Double a(0.1), b(0.2);
+    const std::vector<bwd::Double> inputs{a, b};
+    bwd::Double f(0);
+    for(int i = 0; i < 100; ++i)
+        f = f + bwd::customFunction(polynomialKernel, inputs, 1)[0];
+
+    bwd::Double::DerivativeMap derivative;
+    f.derivative(derivative);
+    return derivative(a);
+}
+
+ADCPP_BENCHMARK("backward/least squares gradient")
+{
+    const long int params = 20;
+    const long int residuals = 200;
+
+    bwd::VectorXd x(params);
+    for(long int i = 0; i < x.size(); ++i)
+        x(i) = bwd::Double(0.1 * i);
+
+    // linear model with a nonlinear feature, fitted against sin(t)
+    bwd::Double f(0);
+    for(long int j = 0; j < residuals; ++j)
+    {
+        const double t = 0.01 * j;
+        bwd::Double model = x(0) * bwd::exp(bwd::Double(-t) * x(1));
+        for(long int i = 2; i < params; ++i)
+            model = model + x(i) * bwd::Double(std::pow(t, static_cast<double>(i - 2)));
+        const auto r = model - bwd::Double(std::sin(t));
+        f = f + r * r;
+    }
+
+    Eigen::VectorXd grad(x.size());
+    bwd::gradient(x, f, grad);
+    return f.value() + grad(0);
+}
+
+ADCPP_BENCHMARK("backward/rosenbrock gradient replay")
+{
+    // the function is recorded once on its own tape and replayed afterwards
+    static bwd::Tape<double> tape;
+    static std::vector<bwd::Double> x;
+    static bwd::Double f(tape, tape.constant(0));
+    static int evaluations = 0;
+
+    if(x.empty())
+    {
+        const bwd::Double one(tape, tape.constant(1));
+        const bwd::Double hundred(tape, tape.constant(100));
+        for(int i = 0; i < 100; ++i)
+            x.push_back(bwd::Double(tape, tape.parameter(0.01 * i)));
+        for(int i = 0; i + 1 < 100; ++i)
+        {
+            const auto a = x[i + 1] - x[i] * x[i];
+            const auto b = one - x[i];
+            f = f + hundred * a * a + b * b;
+        }
+    }
+
+    ++evaluations;
+    for(int i = 0; i < 100; ++i)
+        x[i].setValue(0.01 * i + 1e-9 * (evaluations % 2));
+    tape.replay();
+
+    bwd::Double::DerivativeMap derivative;
+    f.derivative(derivative);
+    return f.value() + derivative(x[99]);
+}
+
+/// @brief Records a least squares fit, whose features only depend on
+/// constants, once on its own tape and replays it afterwards.
+template<bool Optimized>
+static double leastSquaresReplay()
+{
+    const int params = 20;
+    const int residuals = 200;
+
+    static bwd::Tape<double> tape;
+    static std::vector<bwd::Double> x;
+    static std::vector<bwd::Double> f;
+    static int evaluations = 0;
+
+    if(x.empty())
+    {
+        for(int i = 0; i < params; ++i)
+            x.push_back(bwd::Double(tape, tape.parameter(0.1 * i)));
+
+        bwd::Double sum(tape, tape.constant(0));
+        for(int j = 0; j < residuals; ++j)
+        {
+            const bwd::Double t(tape, tape.constant(0.01 * j));
+            bwd::Double model = x[0] * bwd::exp(-t * x[1]);
+            for(int i = 2; i < params; ++i)
+                model = model + x[i] * bwd::pow(t, i - 2);
+            const auto r = model - bwd::sin(t);
+            sum = sum + r * r;
+        }
+        f.push_back(sum);
+
+        if(Optimized)
+            bwd::optimize(f);
+    }
+
+    ++evaluations;
+    for(int i = 0; i < params; ++i)
+        x[i].setValue(0.1 * i + 1e-9 * (evaluations % 2));
+    tape.replay();
+
+    bwd::Double::DerivativeMap derivative;
+    f[0].derivative(derivative);
+    return f[0].value() + derivative(x[1]);
+}
+
+ADCPP_BENCHMARK("backward/least squares replay")
+{
+    return leastSquaresReplay<false>();
+}
+
+ADCPP_BENCHMARK("backward/least squares replay optimized")
+{
+    return leastSquaresReplay<true>();
+}
@@ -0,0 +1,306 @@
+/* adcpp_eigen.bench.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: Fabian Meyer
+ */
+
+#include <benchmark/benchmark.hpp>
+#include <adcpp/adcpp_eigen.hpp>
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+#include <Eigen/SVD>
+
+using namespace adcpp;
+
+ADCPP_BENCHMARK("eigen/forward jacobian")
+{
+    const long int n = 20;
+    fwd::MatrixXd A(n, n);
+    for(long int r = 0; r < n; ++r)
+        for(long int c = 0; c < n; ++c)
+            A(r, c) = fwd::Double(1.0 / (1 + r + c));
+
+    // one evaluation per input direction
+    Eigen::MatrixXd jac(n, n);
+    fwd::VectorXd x(n);
+    for(long int j = 0; j < n; ++j)
+    {
+        for(long int i = 0; i < n; ++i)
+            x(i) = fwd::Double(0.1 * i, i == j ? 1 : 0);
+
+        const fwd::VectorXd f = A * x.array().exp().matrix();
+        for(long int i = 0; i < n; ++i)
+            jac(i, j) = f(i).derivative();
+    }
+
+    return jac(n - 1, n - 1);
+}
+
+struct ExpProduct
+{
+    Eigen::MatrixXd A;
+
+    template<typename Derived>
+    Eigen::Matrix<typename Derived::Scalar, Eigen::Dynamic, 1> operator()(const Eigen::MatrixBase<Derived> &x) const
+    {
+        return A.cast<typename Derived::Scalar>() * x.array().exp().matrix();
+    }
+};
+
+ADCPP_BENCHMARK("eigen/forward jacobian chunked")
+{
+    const long int n = 20;
+    ExpProduct func;
+    func.A.resize(n, n);
+    for(long int r = 0; r < n; ++r)
+        for(long int c = 0; c < n; ++c)
+            func.A(r, c) = 1.0 / (1 + r + c);
+
+    Eigen::VectorXd x(n);
+    for(long int i = 0; i < n; ++i)
+        x(i) = 0.1 * i;
+
+    // eight input directions per evaluation
+    Eigen::MatrixXd jac(n, n);
+    fwd::jacobian(func, x, jac);
+
+    return jac(n - 1, n - 1);
+}
+
+static const ExpProduct &wideExpProduct()
+{
+    static const ExpProduct func = []()
+    {
+        const long int n = 200;
+        ExpProduct result;
+        result.A.resize(n, n);
+        for(long int r = 0; r < n; ++r)
+            for(long int c = 0; c < n; ++c)
+                result.A(r, c) = 1.0 / (1 + r + c);
+        return result;
+    }();
+    return func;
+}
+
+ADCPP_BENCHMARK("eigen/forward jacobian wide serial")
+{
+    const auto &func = wideExpProduct();
+    const Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(func.A.cols(), 0, 1);
+
+    Eigen::MatrixXd jac(func.A.rows(), func.A.cols());
+    fwd::jacobian(func, x, jac);
+
+    return jac(0, 0);
+}
+
+ADCPP_BENCHMARK("eigen/forward jacobian wide parallel")
+{
+    const auto &func = wideExpProduct();
+    const Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(func.A.cols(), 0, 1);
+
+    Eigen::MatrixXd jac(func.A.rows(), func.A.cols());
+    fwd::parallelJacobian(func, x, jac);
+
+    return jac(0, 0);
+}
+
+ADCPP_BENCHMARK("eigen/forward singular value decomposition")
+{
+    fwd::Matrix4d A;
+    A << fwd::Double(2, 1), 3, 11, 5,
+        1, 1, 5, 2,
+        2, 1, -3, 2,
+        1, 1, -3, 4;
+    fwd::Vector4d b;
+    b << 2, 1, -3, -3;
+
+    Eigen::JacobiSVD<fwd::Matrix4d, Eigen::FullPivHouseholderQRPreconditioner>
+        solver(A, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    const fwd::Vector4d x = solver.solve(b);
+
+    return x(0).value() + x(0).derivative();
+}
+
+ADCPP_BENCHMARK("eigen/forward lu solve")
+{
+    fwd::Matrix4d A;
+    A << fwd::Double(2, 1), 3, 11, 5,
+        1, 1, 5, 2,
+        2, 1, -3, 2,
+        1, 1, -3, 4;
+    fwd::Vector4d b;
+    b << 2, 1, -3, -3;
+
+    const fwd::Vector4d x = A.partialPivLu().solve(b);
+
+    return x(0).value() + x(0).derivative();
+}
+
+ADCPP_BENCHMARK("eigen/backward jacobian")
+{
+    const long int n = 20;
+    bwd::MatrixXd A(n, n);
+    for(long int r = 0; r < n; ++r)
+        for(long int c = 0; c < n; ++c)
+            A(r, c) = bwd::Double(1.0 / (1 + r + c));
+
+    bwd::VectorXd x(n);
+    for(long int i = 0; i < n; ++i)
+        x(i) = bwd::Double(0.1 * i);
+
+    const bwd::VectorXd f = A * x.array().exp().matrix();
+    Eigen::MatrixXd jac(n, n);
+    bwd::jacobian(x, f, jac);
+
+    return jac(n - 1, n - 1);
+}
+
+ADCPP_BENCHMARK("eigen/backward matrix product and solve")
+{
+    const long int n = 100;
+    bwd::MatrixXd A(n, n);
+    bwd::MatrixXd B(n, n);
+    for(long int r = 0; r < n; ++r)
+    {
+        for(long int c = 0; c < n; ++c)
+        {
+            A(r, c) = bwd::Double((r == c ? n : 0) + 1.0 / (1 + r + c));
+            B(r, c) = bwd::Double(0.01 * (r - c));
+        }
+    }
+
+    const bwd::MatrixXd X = bwd::luSolve(A, A * B);
+    const bwd::Double f = X.squaredNorm();
+
+    bwd::Double::DerivativeMap derivative;
+    f.derivative(derivative);
+    return f.value() + derivative(B(0, 0));
+}
+
+static bwd::VectorXd tridiagonal(const bwd::VectorXd &x)
+{
+    bwd::VectorXd f(x.size());
+    for(long int i = 0; i < x.size(); ++i)
+    {
+        f(i) = bwd::Double(3) * x(i) * x(i);
+        if(i > 0)
+            f(i) = f(i) - x(i - 1);
+        if(i + 1 < x.size())
+            f(i) = f(i) + bwd::exp(x(i + 1));
+    }
+    return f;
+}
+
+ADCPP_BENCHMARK("eigen/backward tridiagonal jacobian dense")
+{
+    const long int n = 300;
+    bwd::VectorXd x(n);
+    for(long int i = 0; i < n; ++i)
+        x(i) = bwd::Double(0.01 * i);
+
+    const bwd::VectorXd f = tridiagonal(x);
+    Eigen::MatrixXd jac(n, n);
+    bwd::jacobian(x, f, jac);
+
+    return jac(n - 1, n - 1);
+}
+
+ADCPP_BENCHMARK("eigen/backward tridiagonal jacobian sparse")
+{
+    const long int n = 300;
+    bwd::VectorXd x(n);
+    for(long int i = 0; i < n; ++i)
+        x(i) = bwd::Double(0.01 * i);
+
+    const bwd::VectorXd f = tridiagonal(x);
+    Eigen::SparseMatrix<double> jac;
+    bwd::sparseJacobian(x, f, jac);
+
+    return jac.coeff(n - 1, n - 1);
+}
+
+static bwd::Double shardLoss(const bwd::VectorXd &x, const std::vector<double> &shard)
+{
+    bwd::Double loss(0);
+    for(const auto t : shard)
+    {
+        const bwd::Double r = x(0) * bwd::exp(bwd::Double(-t) * x(1)) + x(2) * bwd::sin(x(3) * t)
+            - bwd::Double(std::cos(t));
+        loss = loss + r * r;
+    }
+    return loss;
+}
+
+static const std::vector<std::vector<double>> &shards()
+{
+    static const std::vector<std::vector<double>> shards(64, std::vector<double>(500, 0.25));
+    return shards;
+}
+
+ADCPP_BENCHMARK("eigen/backward sharded gradient serial")
+{
+    Eigen::VectorXd x(4);
+    x << 1, 0.5, 0.3, 2;
+
+    double loss = 0;
+    Eigen::VectorXd grad = Eigen::VectorXd::Zero(4);
+    for(const auto &shard : shards())
+    {
+        const bwd::VectorXd params = x.cast<bwd::Double>();
+        const bwd::Double f = shardLoss(params, shard);
+        Eigen::VectorXd g(4);
+        bwd::gradient(params, f, g);
+        loss += f.value();
+        grad += g;
+    }
+
+    return loss + grad(0);
+}
+
+ADCPP_BENCHMARK("eigen/backward sharded gradient parallel")
+{
+    Eigen::VectorXd x(4);
+    x << 1, 0.5, 0.3, 2;
+
+    Eigen::VectorXd grad(4);
+    const double loss = bwd::parallelGradient(shardLoss, x, shards(), grad);
+
+    return loss + grad(0);
+}
+
+static bwd::VectorXd oscillatorStep(const bwd::VectorXd &state)
+{
+    const bwd::Double dt(0.001);
+    bwd::VectorXd next(3);
+    next(0) = state(0) + dt * state(1);
+    next(1) = state(1) - dt * (state(2) * bwd::sin(state(0)) + bwd::Double(0.1) * state(1));
+    next(2) = state(2);
+    return next;
+}
+
+ADCPP_BENCHMARK("eigen/backward integration recorded")
+{
+    bwd::VectorXd x(3);
+    x << bwd::Double(0.8), bwd::Double(0), bwd::Double(2);
+
+    bwd::VectorXd state = x;
+    for(int k = 0; k < 10000; ++k)
+        state = oscillatorStep(state);
+
+    Eigen::VectorXd grad(3);
+    bwd::gradient(x, state(0), grad);
+    return grad(2);
+}
+
+ADCPP_BENCHMARK("eigen/backward integration checkpointed")
+{
+    bwd::VectorXd x(3);
+    x << bwd::Double(0.8), bwd::Double(0), bwd::Double(2);
+
+    // log2 of the number of steps
+    const bwd::VectorXd state = bwd::checkpointed(oscillatorStep, x, 10000, 14);
+
+    Eigen::VectorXd grad(3);
+    bwd::gradient(x, state(0), grad);
+    return grad(2);
+}
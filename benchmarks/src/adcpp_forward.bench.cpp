@@ -0,0 +1,88 @@
+/* adcpp_forward.bench.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: Fabian Meyer
+ */
+
+#include <benchmark/benchmark.hpp>
+#include <adcpp/adcpp.hpp>
+
+using namespace adcpp;
+
+template<typename Number>
+static Number chain(Number x)
+{
+    for(int i = 0; i < 100; ++i)
+        x = sin(x) * Number(1.1) + exp(-x) / Number(3);
+    return x;
+}
+
+template<typename Number>
+static Number recurse(const Number &x, const int depth)
+{
+    if(depth == 0)
+        return x;
+    return cos(recurse(x, depth - 1)) + x * Number(0.5);
+}
+
+template<typename Number>
+static Number rosenbrock(const Number *x, const int n)
+{
+    Number result(0);
+    for(int i = 0; i + 1 < n; ++i)
+    {
+        const auto a = x[i + 1] - x[i] * x[i];
+        const auto b = Number(1) - x[i];
+        result += Number(100) * a * a + b * b;
+    }
+    return result;
+}
+
+ADCPP_BENCHMARK("forward/scalar chain")
+{
+    const auto f = chain(fwd::Double(0.5, 1));
+    return f.value() + f.derivative();
+}
+
+ADCPP_BENCHMARK("forward/wide sum")
+{
+    const fwd::Double x(0.5, 1);
+    fwd::Double f(0);
+    for(int i = 0; i < 1000; ++i)
+        f += sin(x * fwd::Double(i));
+    return f.value() + f.derivative();
+}
+
+ADCPP_BENCHMARK("forward/deep recursion")
+{
+    const auto f = recurse(fwd::Double(0.5, 1), 1000);
+    return f.value() + f.derivative();
+}
+
+ADCPP_BENCHMARK("forward/rosenbrock gradient 16 directions")
+{
+    using Number = fwd::Number<double, 16>;
+    Number x[16];
+    for(int i = 0; i < 16; ++i)
+        x[i] = Number(0.1 * i, Number::Derivative::Unit(i));
+    const auto f = rosenbrock(x, 16);
+    return f.value() + f.derivative(15);
+}
+
+ADCPP_BENCHMARK("forward/rosenbrock gradient dynamic directions")
+{
+    using Number = fwd::DoubleX;
+    Number x[16];
+    for(int i = 0; i < 16; ++i)
+        x[i] = Number(0.1 * i, Number::Derivative::Unit(16, i));
+    const auto f = rosenbrock(x, 16);
+    return f.value() + f.derivative(15);
+}
+
+ADCPP_BENCHMARK("forward/scalar chain 8 lanes")
+{
+    using Scalar = Lanes<double, 8>;
+    const double points[] = {0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8};
+    const auto f = chain(fwd::Number<Scalar>(Scalar::load(points), Scalar(1)));
+    return f.value()[7] + f.derivative()[7];
+}
@@ -0,0 +1,264 @@
+/* main.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: Fabian Meyer
+ */
+
+#include <benchmark/benchmark.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace benchmark
+{
+    Allocations &Allocations::instance()
+    {
+        static Allocations allocations;
+        return allocations;
+    }
+
+    // every allocation is prefixed with its size, so the live heap can be
+    // tracked without relying on sized deallocation
+    static const std::size_t HeaderSize = alignof(std::max_align_t);
+
+    static void *allocate(const std::size_t size)
+    {
+        auto memory = static_cast<char*>(std::malloc(size + HeaderSize));
+        if(memory == nullptr)
+            throw std::bad_alloc();
+        *reinterpret_cast<std::size_t*>(memory) = size;
+
+        auto &allocations = Allocations::instance();
+        ++allocations.count;
+        allocations.bytes += size;
+        const auto live = allocations.live += size;
+        auto peak = allocations.peak.load();
+        while(live > peak && !allocations.peak.compare_exchange_weak(peak, live))
+        { }
+
+        return memory + HeaderSize;
+    }
+
+    static void deallocate(void *ptr)
+    {
+        if(ptr == nullptr)
+            return;
+        auto memory = static_cast<char*>(ptr) - HeaderSize;
+        Allocations::instance().live -= *reinterpret_cast<std::size_t*>(memory);
+        std::free(memory);
+    }
+
+    /// @brief Returns the peak resident set size of the process in kilobytes
+    /// or zero if it is not available on this platform.
+    static long maxResidentSize()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage;
+        if(getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    struct Result
+    {
+        std::string name;
+        std::size_t iterations;
+        double nsPerOp;
+        double allocationsPerOp;
+        double bytesPerOp;
+        std::size_t peakBytes;
+        long maxRss;
+    };
+
+    static Result run(const Benchmark &bench, const double minTime)
+    {
+        using Clock = std::chrono::steady_clock;
+        auto &allocations = Allocations::instance();
+        volatile double sink = 0;
+
+        // warm up caches and the tape chunks of the active tapes
+        sink = sink + bench.function();
+
+        std::size_t iterations = 1;
+        while(true)
+        {
+            const std::size_t count = allocations.count;
+            const std::size_t bytes = allocations.bytes;
+            const std::size_t live = allocations.live;
+            allocations.peak = live;
+
+            const auto start = Clock::now();
+            for(std::size_t i = 0; i < iterations; ++i)
+                sink = sink + bench.function();
+            const auto end = Clock::now();
+
+            const double elapsed = std::chrono::duration<double>(end - start).count();
+            const std::size_t allocated = allocations.count - count;
+            const std::size_t allocatedBytes = allocations.bytes - bytes;
+            const std::size_t peak = allocations.peak - live;
+
+            if(elapsed >= minTime || iterations >= (std::size_t(1) << 40))
+            {
+                Result result;
+                result.name = bench.name;
+                result.iterations = iterations;
+                result.nsPerOp = elapsed * 1e9 / iterations;
+                result.allocationsPerOp = static_cast<double>(allocated) / iterations;
+                result.bytesPerOp = static_cast<double>(allocatedBytes) / iterations;
+                result.peakBytes = peak;
+                result.maxRss = maxResidentSize();
+                return result;
+            }
+
+            // aim slightly above the minimum time with the next attempt
+            const double factor = elapsed > 0 ? 1.4 * minTime / elapsed : 100;
+            iterations = static_cast<std::size_t>(iterations * std::min(100.0, std::max(2.0, factor)));
+        }
+    }
+
+    static void printCsv(const std::vector<Result> &results)
+    {
+        std::cout << "name,iterations,ns_per_op,allocs_per_op,bytes_per_op,peak_heap_bytes,max_rss_kb\n";
+        for(const auto &result : results)
+        {
+            std::cout << result.name << ','
+                << result.iterations << ','
+                << result.nsPerOp << ','
+                << result.allocationsPerOp << ','
+                << result.bytesPerOp << ','
+                << result.peakBytes << ','
+                << result.maxRss << '\n';
+        }
+    }
+
+    static void printJson(const std::vector<Result> &results)
+    {
+        std::cout << "[\n";
+        for(std::size_t i = 0; i < results.size(); ++i)
+        {
+            const auto &result = results[i];
+            std::cout << "  {\"name\": \"" << result.name << '"'
+                << ", \"iterations\": " << result.iterations
+                << ", \"ns_per_op\": " << result.nsPerOp
+                << ", \"allocs_per_op\": " << result.allocationsPerOp
+                << ", \"bytes_per_op\": " << result.bytesPerOp
+                << ", \"peak_heap_bytes\": " << result.peakBytes
+                << ", \"max_rss_kb\": " << result.maxRss
+                << (i + 1 < results.size() ? "},\n" : "}\n");
+        }
+        std::cout << "]\n";
+    }
+}
+
+void *operator new(std::size_t size)
+{
+    return benchmark::allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return benchmark::allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return benchmark::allocate(size);
+    }
+    catch(...)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return benchmark::allocate(size);
+    }
+    catch(...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void *ptr) noexcept
+{
+    benchmark::deallocate(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    benchmark::deallocate(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    benchmark::deallocate(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    benchmark::deallocate(ptr);
+}
+
+int main(const int argc, const char **argv)
+{
+    bool json = false;
+    double minTime = 0.5;
+    std::string filter;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if(std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+            minTime = std::atof(argv[++i]);
+        else if(argv[i][0] != '-')
+            filter = argv[i];
+        else
+        {
+            std::cerr << "Usage: benchmarks [--json] [--min-time <seconds>] [filter]" << std::endl;
+            return 1;
+        }
+    }
+
+    // registration order depends on the order of static initialization
+    auto benchmarks = benchmark::registry();
+    std::sort(benchmarks.begin(), benchmarks.end(),
+        [](const benchmark::Benchmark &lhs, const benchmark::Benchmark &rhs) { return lhs.name < rhs.name; });
+
+    std::vector<benchmark::Result> results;
+    for(const auto &bench : benchmarks)
+    {
+        if(bench.name.find(filter) == std::string::npos)
+            continue;
+        results.push_back(benchmark::run(bench, minTime));
+        std::cerr << bench.name << ": " << results.back().nsPerOp << " ns/op" << std::endl;
+    }
+
+    std::cout << std::setprecision(6);
+    if(json)
+        benchmark::printJson(results);
+    else
+        benchmark::printCsv(results);
+
+    return 0;
+}
@@ -21,9 +21,10 @@ if(${adcpp_FOUND})
     add_library(adcpp::adcpp ALIAS adcpp)
 
     if(${EIGEN3_FOUND})
+        find_package(Threads REQUIRED)
         add_library(adcpp_eigen INTERFACE)
         target_include_directories(adcpp INTERFACE "${adcpp_INCLUDE_DIR}")
-        target_link_libraries(adcpp_eigen INTERFACE adcpp::adcpp Eigen3::Eigen)
+        target_link_libraries(adcpp_eigen INTERFACE adcpp::adcpp Eigen3::Eigen Threads::Threads)
         add_library(adcpp::adcpp_eigen ALIAS adcpp_eigen)
     endif()
 endif()
\ No newline at end of file
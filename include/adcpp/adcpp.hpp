@@ -8,867 +8,3710 @@
 #ifndef ADCPP_ADCPP_HPP_
 #define ADCPP_ADCPP_HPP_
 
+#include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <ostream>
-#include <map>
-#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#if !defined(ADCPP_NO_SIMD)
+#   if defined(__AVX512F__)
+#       define ADCPP_SIMD_AVX512
+#   elif defined(__AVX__)
+#       define ADCPP_SIMD_AVX
+#   elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define ADCPP_SIMD_SSE
+#   endif
+#endif
+
+#if defined(ADCPP_SIMD_AVX512) || defined(ADCPP_SIMD_AVX) || defined(ADCPP_SIMD_SSE)
+#   include <immintrin.h>
+#endif
+
+#if defined(ADCPP_THREAD_SAFE)
+#   include <atomic>
+#endif
 
 namespace adcpp
 {
-namespace fwd
+namespace internal
 {
-    /// @brief Generic number type for computing derivate in forward mode.
-    /// @tparam _Scalar internal scalar type
-    template<typename _Scalar>
-    class Number
+    /// @brief Describes the SIMD registers available for a scalar type.
+    /// Size is the number of scalars per register and zero if the scalar
+    /// type cannot be vectorized.
+    template<typename Scalar>
+    struct SimdTraits
     {
-    public:
-        using Scalar = _Scalar;
+        static constexpr std::size_t Size = 0;
+    };
 
-        Number() = default;
-        Number(const Number<Scalar> &rhs) = default;
-        Number(Number<Scalar> &&rhs) = default;
-        ~Number() = default;
+#if defined(ADCPP_SIMD_AVX512)
+    template<>
+    struct SimdTraits<double>
+    {
+        using Register = __m512d;
+        static constexpr std::size_t Size = 8;
+
+        static Register load(const double *x) { return _mm512_loadu_pd(x); }
+        static void store(double *y, const Register x) { _mm512_storeu_pd(y, x); }
+        static Register set1(const double a) { return _mm512_set1_pd(a); }
+        static Register mul(const Register a, const Register b) { return _mm512_mul_pd(a, b); }
+        static Register madd(const Register a, const Register b, const Register c) { return _mm512_fmadd_pd(a, b, c); }
+        static Register abs(const Register x) { return _mm512_abs_pd(x); }
+    };
 
-        Number(const Scalar value)
-            : value_(value)
-        { }
+    template<>
+    struct SimdTraits<float>
+    {
+        using Register = __m512;
+        static constexpr std::size_t Size = 16;
+
+        static Register load(const float *x) { return _mm512_loadu_ps(x); }
+        static void store(float *y, const Register x) { _mm512_storeu_ps(y, x); }
+        static Register set1(const float a) { return _mm512_set1_ps(a); }
+        static Register mul(const Register a, const Register b) { return _mm512_mul_ps(a, b); }
+        static Register madd(const Register a, const Register b, const Register c) { return _mm512_fmadd_ps(a, b, c); }
+        static Register abs(const Register x) { return _mm512_abs_ps(x); }
+    };
+#elif defined(ADCPP_SIMD_AVX)
+    template<>
+    struct SimdTraits<double>
+    {
+        using Register = __m256d;
+        static constexpr std::size_t Size = 4;
+
+        static Register load(const double *x) { return _mm256_loadu_pd(x); }
+        static void store(double *y, const Register x) { _mm256_storeu_pd(y, x); }
+        static Register set1(const double a) { return _mm256_set1_pd(a); }
+        static Register mul(const Register a, const Register b) { return _mm256_mul_pd(a, b); }
+#if defined(__FMA__)
+        static Register madd(const Register a, const Register b, const Register c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+        static Register madd(const Register a, const Register b, const Register c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+        static Register abs(const Register x) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x); }
+    };
 
-        Number(const Scalar value, const Scalar derivative)
-            : value_(value), derivative_(derivative)
-        { }
+    template<>
+    struct SimdTraits<float>
+    {
+        using Register = __m256;
+        static constexpr std::size_t Size = 8;
+
+        static Register load(const float *x) { return _mm256_loadu_ps(x); }
+        static void store(float *y, const Register x) { _mm256_storeu_ps(y, x); }
+        static Register set1(const float a) { return _mm256_set1_ps(a); }
+        static Register mul(const Register a, const Register b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__)
+        static Register madd(const Register a, const Register b, const Register c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+        static Register madd(const Register a, const Register b, const Register c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+        static Register abs(const Register x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+    };
+#elif defined(ADCPP_SIMD_SSE)
+    template<>
+    struct SimdTraits<double>
+    {
+        using Register = __m128d;
+        static constexpr std::size_t Size = 2;
+
+        static Register load(const double *x) { return _mm_loadu_pd(x); }
+        static void store(double *y, const Register x) { _mm_storeu_pd(y, x); }
+        static Register set1(const double a) { return _mm_set1_pd(a); }
+        static Register mul(const Register a, const Register b) { return _mm_mul_pd(a, b); }
+        static Register madd(const Register a, const Register b, const Register c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+        static Register abs(const Register x) { return _mm_andnot_pd(_mm_set1_pd(-0.0), x); }
+    };
 
-        Scalar value() const
-        {
-            return value_;
-        }
+    template<>
+    struct SimdTraits<float>
+    {
+        using Register = __m128;
+        static constexpr std::size_t Size = 4;
+
+        static Register load(const float *x) { return _mm_loadu_ps(x); }
+        static void store(float *y, const Register x) { _mm_storeu_ps(y, x); }
+        static Register set1(const float a) { return _mm_set1_ps(a); }
+        static Register mul(const Register a, const Register b) { return _mm_mul_ps(a, b); }
+        static Register madd(const Register a, const Register b, const Register c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static Register abs(const Register x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+    };
+#endif
 
-        Scalar derivative() const
+    /// @brief Kernels operating on contiguous arrays of scalars.
+    /// The generic version uses plain loops.
+    template<typename Scalar, bool Vectorized = (SimdTraits<Scalar>::Size > 0)>
+    struct Kernel
+    {
+        static void scale(const std::size_t n, const Scalar a, const Scalar *x, Scalar *y)
         {
-            return derivative_;
+            for(std::size_t i = 0; i < n; ++i)
+                y[i] = a * x[i];
         }
 
-        Number<Scalar> &operator=(const Number<Scalar> &rhs) & = default;
-        Number<Scalar> &operator=(Number<Scalar> &&rhs) && = default;
-
-        Number<Scalar> &operator=(const Scalar rhs) &
+        static void axpy(const std::size_t n, const Scalar a, const Scalar *x, Scalar *y)
         {
-            value_ = rhs;
-            derivative_ = 0;
-
-            return *this;
+            for(std::size_t i = 0; i < n; ++i)
+                y[i] += a * x[i];
         }
 
-        Number<Scalar> &operator+=(const Number<Scalar> &rhs)
+        static void axpby(const std::size_t n, const Scalar a, const Scalar *x, const Scalar b, Scalar *y)
         {
-            value_ += rhs.value_;
-            derivative_ += rhs.derivative_;
-
-            return *this;
+            for(std::size_t i = 0; i < n; ++i)
+                y[i] = a * x[i] + b * y[i];
         }
 
-        Number<Scalar> &operator*=(const Number<Scalar> &rhs)
+        static void abs(const std::size_t n, const Scalar *x, Scalar *y)
         {
-            derivative_ = rhs.value_ * derivative_  + value_ * rhs.derivative_;
-            value_ *= rhs.value_;
-
-            return *this;
+            using std::abs;
+            for(std::size_t i = 0; i < n; ++i)
+                y[i] = abs(x[i]);
         }
+    };
 
-        Number<Scalar> &operator-=(const Number<Scalar> &rhs)
+    /// @brief Kernels operating on contiguous arrays of scalars.
+    /// The vectorized version processes full SIMD registers and handles the
+    /// remaining elements with the generic loops.
+    template<typename Scalar>
+    struct Kernel<Scalar, true>
+    {
+        using Simd = SimdTraits<Scalar>;
+        using Generic = Kernel<Scalar, false>;
+
+        static void scale(const std::size_t n, const Scalar a, const Scalar *x, Scalar *y)
         {
-            *this += -rhs;
-            return *this;
+            const auto va = Simd::set1(a);
+            std::size_t i = 0;
+            for(; i + Simd::Size <= n; i += Simd::Size)
+                Simd::store(y + i, Simd::mul(va, Simd::load(x + i)));
+            Generic::scale(n - i, a, x + i, y + i);
         }
 
-        Number<Scalar> &operator/=(const Number<Scalar> &rhs)
+        static void axpy(const std::size_t n, const Scalar a, const Scalar *x, Scalar *y)
         {
-            derivative_ = (derivative_ * rhs.value_ - rhs.derivative_ * value_) / (rhs.value_ * rhs.value_);
-            value_ /= rhs.value_;
-
-            return *this;
+            const auto va = Simd::set1(a);
+            std::size_t i = 0;
+            for(; i + Simd::Size <= n; i += Simd::Size)
+                Simd::store(y + i, Simd::madd(va, Simd::load(x + i), Simd::load(y + i)));
+            Generic::axpy(n - i, a, x + i, y + i);
         }
 
-        Number<Scalar> operator-() const
+        static void axpby(const std::size_t n, const Scalar a, const Scalar *x, const Scalar b, Scalar *y)
         {
-            return Number<Scalar>(-value_, -derivative_);
+            const auto va = Simd::set1(a);
+            const auto vb = Simd::set1(b);
+            std::size_t i = 0;
+            for(; i + Simd::Size <= n; i += Simd::Size)
+                Simd::store(y + i, Simd::madd(va, Simd::load(x + i), Simd::mul(vb, Simd::load(y + i))));
+            Generic::axpby(n - i, a, x + i, b, y + i);
         }
 
-        explicit operator Scalar() const
+        static void abs(const std::size_t n, const Scalar *x, Scalar *y)
         {
-            return value();
+            std::size_t i = 0;
+            for(; i + Simd::Size <= n; i += Simd::Size)
+                Simd::store(y + i, Simd::abs(Simd::load(x + i)));
+            Generic::abs(n - i, x + i, y + i);
         }
-
-    private:
-        Scalar value_{0};
-        Scalar derivative_{0};
     };
 
+    /// @brief Computes y = a * x.
     template<typename Scalar>
-    inline Number<Scalar> operator+(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
+    inline void scale(const std::size_t n, const Scalar a, const Scalar *x, Scalar *y)
     {
-        auto result = lhs;
-        result += rhs;
-        return result;
+        Kernel<Scalar>::scale(n, a, x, y);
     }
 
+    /// @brief Computes y = y + a * x.
     template<typename Scalar>
-    inline Number<Scalar> operator-(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
+    inline void axpy(const std::size_t n, const Scalar a, const Scalar *x, Scalar *y)
     {
-        auto result = lhs;
-        result -= rhs;
-        return result;
+        Kernel<Scalar>::axpy(n, a, x, y);
     }
 
+    /// @brief Computes y = a * x + b * y.
     template<typename Scalar>
-    inline Number<Scalar> operator/(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
+    inline void axpby(const std::size_t n, const Scalar a, const Scalar *x, const Scalar b, Scalar *y)
     {
-        auto result = lhs;
-        result /= rhs;
-        return result;
+        Kernel<Scalar>::axpby(n, a, x, b, y);
     }
 
+    /// @brief Computes y = |x|.
     template<typename Scalar>
-    inline Number<Scalar> operator*(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
+    inline void abs(const std::size_t n, const Scalar *x, Scalar *y)
     {
-        auto result = lhs;
-        result *= rhs;
-        return result;
+        Kernel<Scalar>::abs(n, x, y);
     }
+}
 
-    template<typename Scalar>
-    inline bool operator==(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
+namespace internal
+{
+namespace math
+{
+    // Elementary functions for lanes. Full SIMD registers of doubles are
+    // evaluated without branches in terms of a small set of primitives, with
+    // the polynomial approximations of the Cephes math library. All other
+    // lanes use the standard library, which is faster for single values. Both
+    // agree to within a few ulp, not bit for bit.
+
+#if defined(ADCPP_SIMD_AVX512) || (defined(ADCPP_SIMD_AVX) && defined(__AVX2__)) || defined(ADCPP_SIMD_SSE)
+    /// @brief Full SIMD register of doubles which provides the primitives of
+    /// the elementary functions.
+    struct Packet
     {
-        return lhs.value() == rhs.value();
-    }
+#if defined(ADCPP_SIMD_AVX512)
+        using Register = __m512d;
+        using MaskRegister = __mmask8;
+        static constexpr std::size_t Size = 8;
+#elif defined(ADCPP_SIMD_AVX)
+        using Register = __m256d;
+        using MaskRegister = __m256d;
+        static constexpr std::size_t Size = 4;
+#else
+        using Register = __m128d;
+        using MaskRegister = __m128d;
+        static constexpr std::size_t Size = 2;
+#endif
 
-    template<typename Scalar>
-    inline bool operator!=(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
-    {
-        return lhs.value() != rhs.value();
-    }
+        struct Mask
+        {
+            MaskRegister m;
+        };
 
-    template<typename Scalar>
-    inline bool operator<(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
-    {
-        return lhs.value() < rhs.value();
-    }
+        Register v;
 
-    template<typename Scalar>
-    inline bool operator<=(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
-    {
-        return lhs.value() <= rhs.value();
-    }
+        Packet() = default;
 
-    template<typename Scalar>
-    inline bool operator>(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
-    {
-        return lhs.value() > rhs.value();
-    }
+        Packet(const Register v)
+            : v(v)
+        { }
 
-    template<typename Scalar>
-    inline bool operator>=(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
-    {
-        return lhs.value() >= rhs.value();
-    }
+        Packet(const double a)
+            : v(SimdTraits<double>::set1(a))
+        { }
 
-    template<typename Scalar>
-    inline std::ostream& operator<<(std::ostream &lhs, const Number<Scalar> &rhs)
-    {
-        lhs << '(' << rhs.value() << ',' << rhs.derivative() << ')';
-        return lhs;
-    }
+        static Packet load(const double *x)
+        {
+            return Packet(SimdTraits<double>::load(x));
+        }
 
-    template<typename Scalar>
-    inline Scalar &operator+=(Scalar &lhs, const Number<Scalar> &rhs)
-    {
-        lhs += rhs.value();
-        return lhs;
-    }
+        void store(double *y) const
+        {
+            SimdTraits<double>::store(y, v);
+        }
+    };
 
-    template<typename Scalar>
-    inline Number<Scalar> operator+(const Scalar lhs, const Number<Scalar> &rhs)
+#if defined(ADCPP_SIMD_AVX512)
+    // GCC warns about the undefined pass-through operand used inside some of
+    // the AVX-512 intrinsics
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+    inline Packet operator+(const Packet &a, const Packet &b) { return _mm512_add_pd(a.v, b.v); }
+    inline Packet operator-(const Packet &a, const Packet &b) { return _mm512_sub_pd(a.v, b.v); }
+    inline Packet operator*(const Packet &a, const Packet &b) { return _mm512_mul_pd(a.v, b.v); }
+    inline Packet operator/(const Packet &a, const Packet &b) { return _mm512_div_pd(a.v, b.v); }
+    inline Packet operator-(const Packet &a) { return _mm512_sub_pd(_mm512_setzero_pd(), a.v); }
+    inline Packet::Mask operator==(const Packet &a, const Packet &b) { return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ)}; }
+    inline Packet::Mask operator!=(const Packet &a, const Packet &b) { return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_NEQ_UQ)}; }
+    inline Packet::Mask operator<(const Packet &a, const Packet &b) { return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ)}; }
+    inline Packet::Mask operator>(const Packet &a, const Packet &b) { return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ)}; }
+    inline Packet::Mask operator>=(const Packet &a, const Packet &b) { return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ)}; }
+    inline Packet::Mask operator|(const Packet::Mask &a, const Packet::Mask &b) { return {static_cast<__mmask8>(a.m | b.m)}; }
+    inline Packet::Mask operator!=(const Packet::Mask &a, const Packet::Mask &b) { return {static_cast<__mmask8>(a.m ^ b.m)}; }
+    inline Packet select(const Packet::Mask &mask, const Packet &a, const Packet &b) { return _mm512_mask_blend_pd(mask.m, b.v, a.v); }
+    inline Packet floor(const Packet &x) { return _mm512_roundscale_pd(x.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    inline Packet abs(const Packet &x) { return _mm512_abs_pd(x.v); }
+    inline Packet min(const Packet &a, const Packet &b) { return _mm512_min_pd(a.v, b.v); }
+    inline Packet max(const Packet &a, const Packet &b) { return _mm512_max_pd(a.v, b.v); }
+
+    inline Packet exp2i(const Packet &n)
     {
-        return Number<Scalar>(lhs) + rhs;
+        const auto biased = _mm512_castpd_si512(_mm512_add_pd(n.v, _mm512_set1_pd(4503599627371519.0)));
+        return _mm512_castsi512_pd(_mm512_slli_epi64(biased, 52));
     }
 
-    template<typename Scalar>
-    inline Scalar &operator-=(Scalar &lhs, const Number<Scalar> &rhs)
+    inline Packet exponent(const Packet &x)
     {
-        lhs -= rhs.value();
-        return lhs;
+        const auto e = _mm512_and_si512(_mm512_srli_epi64(_mm512_castpd_si512(x.v), 52), _mm512_set1_epi64(0x7ff));
+        const auto d = _mm512_castsi512_pd(_mm512_or_si512(e, _mm512_set1_epi64(0x4330000000000000ll)));
+        return _mm512_sub_pd(d, _mm512_set1_pd(4503599627371518.0));
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> operator-(const Scalar lhs, const Number<Scalar> &rhs)
+    inline Packet mantissa(const Packet &x)
     {
-        return Number<Scalar>(lhs) - rhs;
+        const auto m = _mm512_and_si512(_mm512_castpd_si512(x.v), _mm512_set1_epi64(static_cast<long long>(0x800fffffffffffffull)));
+        return _mm512_castsi512_pd(_mm512_or_si512(m, _mm512_set1_epi64(0x3fe0000000000000ll)));
     }
-
-    template<typename Scalar>
-    inline Scalar &operator*=(Scalar &lhs, const Number<Scalar> &rhs)
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic pop
+#endif
+#elif defined(ADCPP_SIMD_AVX)
+    inline Packet operator+(const Packet &a, const Packet &b) { return _mm256_add_pd(a.v, b.v); }
+    inline Packet operator-(const Packet &a, const Packet &b) { return _mm256_sub_pd(a.v, b.v); }
+    inline Packet operator*(const Packet &a, const Packet &b) { return _mm256_mul_pd(a.v, b.v); }
+    inline Packet operator/(const Packet &a, const Packet &b) { return _mm256_div_pd(a.v, b.v); }
+    inline Packet operator-(const Packet &a) { return _mm256_sub_pd(_mm256_setzero_pd(), a.v); }
+    inline Packet::Mask operator==(const Packet &a, const Packet &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)}; }
+    inline Packet::Mask operator!=(const Packet &a, const Packet &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_NEQ_UQ)}; }
+    inline Packet::Mask operator<(const Packet &a, const Packet &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+    inline Packet::Mask operator>(const Packet &a, const Packet &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+    inline Packet::Mask operator>=(const Packet &a, const Packet &b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ)}; }
+    inline Packet::Mask operator|(const Packet::Mask &a, const Packet::Mask &b) { return {_mm256_or_pd(a.m, b.m)}; }
+    inline Packet::Mask operator!=(const Packet::Mask &a, const Packet::Mask &b) { return {_mm256_xor_pd(a.m, b.m)}; }
+    inline Packet select(const Packet::Mask &mask, const Packet &a, const Packet &b) { return _mm256_blendv_pd(b.v, a.v, mask.m); }
+    inline Packet floor(const Packet &x) { return _mm256_floor_pd(x.v); }
+    inline Packet abs(const Packet &x) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x.v); }
+    inline Packet min(const Packet &a, const Packet &b) { return _mm256_min_pd(a.v, b.v); }
+    inline Packet max(const Packet &a, const Packet &b) { return _mm256_max_pd(a.v, b.v); }
+
+    inline Packet exp2i(const Packet &n)
     {
-        lhs *= rhs.value();
-        return lhs;
+        const auto biased = _mm256_castpd_si256(_mm256_add_pd(n.v, _mm256_set1_pd(4503599627371519.0)));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(biased, 52));
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> operator*(const Scalar lhs, const Number<Scalar> &rhs)
+    inline Packet exponent(const Packet &x)
     {
-        return Number<Scalar>(lhs) * rhs;
+        const auto e = _mm256_and_si256(_mm256_srli_epi64(_mm256_castpd_si256(x.v), 52), _mm256_set1_epi64x(0x7ff));
+        const auto d = _mm256_castsi256_pd(_mm256_or_si256(e, _mm256_set1_epi64x(0x4330000000000000ll)));
+        return _mm256_sub_pd(d, _mm256_set1_pd(4503599627371518.0));
     }
 
-    template<typename Scalar>
-    inline Scalar &operator/=(Scalar &lhs, const Number<Scalar> &rhs)
+    inline Packet mantissa(const Packet &x)
     {
-        lhs /= rhs.value();
-        return lhs;
+        const auto m = _mm256_and_si256(_mm256_castpd_si256(x.v), _mm256_set1_epi64x(static_cast<long long>(0x800fffffffffffffull)));
+        return _mm256_castsi256_pd(_mm256_or_si256(m, _mm256_set1_epi64x(0x3fe0000000000000ll)));
     }
-
-    template<typename Scalar>
-    inline Number<Scalar> operator/(const Scalar lhs, const Number<Scalar> &rhs)
+#else
+    inline Packet operator+(const Packet &a, const Packet &b) { return _mm_add_pd(a.v, b.v); }
+    inline Packet operator-(const Packet &a, const Packet &b) { return _mm_sub_pd(a.v, b.v); }
+    inline Packet operator*(const Packet &a, const Packet &b) { return _mm_mul_pd(a.v, b.v); }
+    inline Packet operator/(const Packet &a, const Packet &b) { return _mm_div_pd(a.v, b.v); }
+    inline Packet operator-(const Packet &a) { return _mm_sub_pd(_mm_setzero_pd(), a.v); }
+    inline Packet::Mask operator==(const Packet &a, const Packet &b) { return {_mm_cmpeq_pd(a.v, b.v)}; }
+    inline Packet::Mask operator!=(const Packet &a, const Packet &b) { return {_mm_cmpneq_pd(a.v, b.v)}; }
+    inline Packet::Mask operator<(const Packet &a, const Packet &b) { return {_mm_cmplt_pd(a.v, b.v)}; }
+    inline Packet::Mask operator>(const Packet &a, const Packet &b) { return {_mm_cmpgt_pd(a.v, b.v)}; }
+    inline Packet::Mask operator>=(const Packet &a, const Packet &b) { return {_mm_cmpge_pd(a.v, b.v)}; }
+    inline Packet::Mask operator|(const Packet::Mask &a, const Packet::Mask &b) { return {_mm_or_pd(a.m, b.m)}; }
+    inline Packet::Mask operator!=(const Packet::Mask &a, const Packet::Mask &b) { return {_mm_xor_pd(a.m, b.m)}; }
+    inline Packet select(const Packet::Mask &mask, const Packet &a, const Packet &b) { return _mm_or_pd(_mm_and_pd(mask.m, a.v), _mm_andnot_pd(mask.m, b.v)); }
+    inline Packet abs(const Packet &x) { return _mm_andnot_pd(_mm_set1_pd(-0.0), x.v); }
+    inline Packet min(const Packet &a, const Packet &b) { return _mm_min_pd(a.v, b.v); }
+    inline Packet max(const Packet &a, const Packet &b) { return _mm_max_pd(a.v, b.v); }
+
+    inline Packet floor(const Packet &x)
     {
-        return Number<Scalar>(lhs) / rhs;
+#if defined(__SSE4_1__)
+        return _mm_floor_pd(x.v);
+#else
+        // round to nearest by adding and subtracting 1.5 * 2^52, valid for |x| < 2^51
+        const auto magic = _mm_set1_pd(6755399441055744.0);
+        const auto rounded = _mm_sub_pd(_mm_add_pd(x.v, magic), magic);
+        return _mm_sub_pd(rounded, _mm_and_pd(_mm_cmpgt_pd(rounded, x.v), _mm_set1_pd(1.0)));
+#endif
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> sin(const Number<Scalar> &val)
+    inline Packet exp2i(const Packet &n)
     {
-        Scalar value = std::sin(val.value());
-        Scalar derivative = val.derivative() * std::cos(val.value());
-        return Number<Scalar>(value, derivative);
+        const auto biased = _mm_castpd_si128(_mm_add_pd(n.v, _mm_set1_pd(4503599627371519.0)));
+        return _mm_castsi128_pd(_mm_slli_epi64(biased, 52));
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> asin(const Number<Scalar> &val)
+    inline Packet exponent(const Packet &x)
     {
-        Scalar value = std::asin(val.value());
-        Scalar derivative = val.derivative() * 1 / std::sqrt(1 - val.value() * val.value());
-        return Number<Scalar>(value, derivative);
+        const auto e = _mm_and_si128(_mm_srli_epi64(_mm_castpd_si128(x.v), 52), _mm_set1_epi64x(0x7ff));
+        const auto d = _mm_castsi128_pd(_mm_or_si128(e, _mm_set1_epi64x(0x4330000000000000ll)));
+        return _mm_sub_pd(d, _mm_set1_pd(4503599627371518.0));
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> cos(const Number<Scalar> &val)
+    inline Packet mantissa(const Packet &x)
     {
-        Scalar value = std::cos(val.value());
-        Scalar derivative = val.derivative() * -std::sin(val.value());
-        return Number<Scalar>(value, derivative);
+        const auto m = _mm_and_si128(_mm_castpd_si128(x.v), _mm_set1_epi64x(static_cast<long long>(0x800fffffffffffffull)));
+        return _mm_castsi128_pd(_mm_or_si128(m, _mm_set1_epi64x(0x3fe0000000000000ll)));
     }
+#endif
+#define ADCPP_SIMD_MATH
+#endif
 
-    template<typename Scalar>
-    inline Number<Scalar> acos(const Number<Scalar> &val)
+#if defined(ADCPP_SIMD_MATH)
+    template<typename V>
+    inline V exp(const V &x)
     {
-        Scalar value = std::acos(val.value());
-        Scalar derivative = val.derivative() * -1 / std::sqrt(1 - val.value() * val.value());
-        return Number<Scalar>(value, derivative);
+        const double maxLog = 7.09782712893383996843e2;
+        const double minLog = -7.45133219101941108420e2;
+        const double c1 = 6.93145751953125e-1;
+        const double c2 = 1.42860682030941723212e-6;
+
+        const V xc = min(max(x, V(minLog)), V(maxLog));
+        const V n = floor(V(1.4426950408889634073599) * xc + V(0.5));
+        const V r = (xc - n * V(c1)) - n * V(c2);
+        const V rr = r * r;
+
+        const V p = r * ((V(1.26177193074810590878e-4) * rr
+            + V(3.02994407707441961300e-2)) * rr
+            + V(9.99999999999999999910e-1));
+        const V q = ((V(3.00198505138664455042e-6) * rr
+            + V(2.52448340349684104192e-3)) * rr
+            + V(2.27265548208155028766e-1)) * rr
+            + V(2.00000000000000000009e0);
+
+        // split the power of two, so subnormal results are representable
+        const V n1 = floor(V(0.5) * n);
+        const V result = (V(1) + V(2) * (p / (q - p))) * exp2i(n1) * exp2i(n - n1);
+
+        return select(x != x, x,
+            select(x > V(maxLog), V(std::numeric_limits<double>::infinity()),
+            select(x < V(minLog), V(0), result)));
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> tan(const Number<Scalar> &val)
+    template<typename V>
+    inline V log(const V &x)
     {
-        Scalar value = std::tan(val.value());
-        Scalar c = std::cos(val.value());
-        Scalar derivative = val.derivative() * 1 / (c * c);
-        return Number<Scalar>(value, derivative);
+        // scale subnormal numbers into the normal range
+        const auto subnormal = x < V(std::numeric_limits<double>::min());
+        const V xs = select(subnormal, x * V(18014398509481984.0), x);
+
+        V e = exponent(xs) - select(subnormal, V(54), V(0));
+        V m = mantissa(xs);
+
+        const auto small = m < V(7.07106781186547524401e-1);
+        e = select(small, e - V(1), e);
+        m = select(small, m + m - V(1), m - V(1));
+
+        const V z = m * m;
+        const V p = ((((V(1.01875663804580931796e-4) * m
+            + V(4.97494994976747001425e-1)) * m
+            + V(4.70579119878881725854e0)) * m
+            + V(1.44989225341610930846e1)) * m
+            + V(1.79368678507819816313e1)) * m
+            + V(7.70838733755885391666e0);
+        const V q = ((((m
+            + V(1.12873587189167450590e1)) * m
+            + V(4.52279145837532221105e1)) * m
+            + V(8.29875266912776603211e1)) * m
+            + V(7.11544750618563894466e1)) * m
+            + V(2.31251620126765340583e1);
+
+        V y = m * (z * p / q) - e * V(2.121944400546905827679e-4) - V(0.5) * z;
+        y = m + y + e * V(0.693359375);
+
+        return select((x != x) | (x < V(0)), V(std::numeric_limits<double>::quiet_NaN()),
+            select(x == V(0), V(-std::numeric_limits<double>::infinity()),
+            select(x == V(std::numeric_limits<double>::infinity()), x, y)));
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> atan(const Number<Scalar> &val)
+    /// @brief Computes sine (cosine = false) or cosine (cosine = true) of x.
+    /// Accurate for |x| < 2^30.
+    template<typename V>
+    inline V sincos(const V &x, const bool cosine)
     {
-        Scalar value = std::atan(val.value());
-        Scalar derivative = val.derivative() * 1 / (1 + val.value() * val.value());
-
-        return Number<Scalar>(value, derivative);
+        const double dp1 = 7.85398125648498535156e-1;
+        const double dp2 = 3.77489470793079817668e-8;
+        const double dp3 = 2.69515142907905952645e-15;
+
+        // reduce to octants, j is the (even) octant modulo 8
+        const V ax = abs(x);
+        V y = floor(ax * V(1.27323954473516268615));
+        y = y + (y - V(2) * floor(V(0.5) * y));
+        const V j = y - V(8) * floor(V(0.125) * y);
+
+        const auto upper = j >= V(4);
+        const auto second = (j == V(2)) | (j == V(6));
+
+        const V z = ((ax - y * V(dp1)) - y * V(dp2)) - y * V(dp3);
+        const V zz = z * z;
+
+        const V s = z + z * zz * (((((V(1.58962301576546568060e-10) * zz
+            - V(2.50507477628578072866e-8)) * zz
+            + V(2.75573136213857245213e-6)) * zz
+            - V(1.98412698295895385996e-4)) * zz
+            + V(8.33333333332211858878e-3)) * zz
+            - V(1.66666666666666307295e-1));
+        const V c = V(1) - V(0.5) * zz + zz * zz * (((((V(-1.13585365213876817300e-11) * zz
+            + V(2.08757008419747316778e-9)) * zz
+            - V(2.75573141792967388112e-7)) * zz
+            + V(2.48015872888517045348e-5)) * zz
+            - V(1.38888888888730564116e-3)) * zz
+            + V(4.16666666666665929218e-2));
+
+        const V result = cosine ? select(second, s, c) : select(second, c, s);
+        const auto negative = cosine ? (upper != second) : (upper != (x < V(0)));
+        return select((x != x) | (ax == V(std::numeric_limits<double>::infinity())),
+            V(std::numeric_limits<double>::quiet_NaN()),
+            select(negative, -result, result));
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> atan2(const Number<Scalar> &y, const Number<Scalar> &x)
+#endif
+
+    struct Exp
     {
-        Scalar value = std::atan2(y.value(), x.value());
-        Scalar denom = x.value() * x.value() + y.value() * y.value();
-        Scalar derivative = x.derivative() * y.value() / denom +
-            y.derivative() * x.value() / denom;
+        double operator()(const double x) const
+        {
+            return std::exp(x);
+        }
 
-        return Number<Scalar>(value, derivative);
-    }
+#if defined(ADCPP_SIMD_MATH)
+        Packet operator()(const Packet &x) const
+        {
+            return exp(x);
+        }
+#endif
+    };
 
-    template<typename Scalar>
-    inline Number<Scalar> exp(const Number<Scalar> &val)
+    struct Log
     {
-        Scalar value = std::exp(val.value());
-        Scalar derivative = val.derivative() * std::exp(val.value());
-        return Number<Scalar>(value, derivative);
-    }
+        double operator()(const double x) const
+        {
+            return std::log(x);
+        }
 
-    template<typename Scalar>
-    inline Number<Scalar> pow(const Number<Scalar> &val, const Scalar exponent)
-    {
-        Scalar value = std::pow(val.value(), exponent);
-        Scalar derivative = val.derivative() * exponent * std::pow(val.value(), exponent - 1);
-        return Number<Scalar>(value, derivative);
-    }
+#if defined(ADCPP_SIMD_MATH)
+        Packet operator()(const Packet &x) const
+        {
+            return log(x);
+        }
+#endif
+    };
 
-    template<typename Scalar>
-    inline Number<Scalar> pow(const Number<Scalar> &val, const int exponent)
+    struct Sin
     {
-        Scalar value = std::pow(val.value(), exponent);
-        Scalar derivative = val.derivative() * exponent * std::pow(val.value(), exponent - 1);
-        return Number<Scalar>(value, derivative);
-    }
+        double operator()(const double x) const
+        {
+            return std::sin(x);
+        }
 
-    template<typename Scalar>
-    inline Number<Scalar> sqrt(const Number<Scalar> &val)
-    {
-        Scalar value = std::sqrt(val.value());
-        Scalar derivative = val.derivative() / (2 * value);
-        return Number<Scalar>(value, derivative);
-    }
+#if defined(ADCPP_SIMD_MATH)
+        Packet operator()(const Packet &x) const
+        {
+            return sincos(x, false);
+        }
+#endif
+    };
 
-    template<typename Scalar>
-    inline Number<Scalar> conj(const Number<Scalar> &val)
+    struct Cos
     {
-        return val;
-    }
+        double operator()(const double x) const
+        {
+            return std::cos(x);
+        }
 
-    template<typename Scalar>
-    inline Number<Scalar> real(const Number<Scalar> &val)
-    {
-        return val;
-    }
+#if defined(ADCPP_SIMD_MATH)
+        Packet operator()(const Packet &x) const
+        {
+            return sincos(x, true);
+        }
+#endif
+    };
 
-    template<typename Scalar>
-    inline Number<Scalar> imag(const Number<Scalar> &)
+    /// @brief Applies the given elementary function to each lane. Float lanes
+    /// are evaluated in double precision.
+    template<typename Func, typename Lanes>
+    inline Lanes apply(const Func &func, const Lanes &x)
     {
-        return Number<Scalar>(0, 0);
+        Lanes result;
+        for(std::size_t i = 0; i < x.size(); ++i)
+            result[i] = static_cast<typename Lanes::Scalar>(func(static_cast<double>(x[i])));
+        return result;
     }
 
-    template<typename Scalar>
-    inline Number<Scalar> abs(const Number<Scalar> &val)
+#if defined(ADCPP_SIMD_MATH)
+    /// @brief Applies the given elementary function to full SIMD registers of
+    /// double lanes and to the remaining lanes one by one.
+    template<typename Func, template<typename, int> class Lanes, int Width>
+    inline Lanes<double, Width> apply(const Func &func, const Lanes<double, Width> &x)
     {
-        return Number<Scalar>(std::abs(val.value()), std::abs(val.derivative()));
+        Lanes<double, Width> result;
+        std::size_t i = 0;
+        for(; i + Packet::Size <= x.size(); i += Packet::Size)
+            func(Packet::load(&x[i])).store(&result[i]);
+        for(; i < x.size(); ++i)
+            result[i] = func(x[i]);
+        return result;
     }
+#endif
+}
+}
 
-    template<typename Scalar>
-    inline Number<Scalar> abs2(const Number<Scalar> &val)
+    /// @brief Fixed number of scalars which are processed in lock step.
+    ///
+    /// Lanes can be used as scalar type of forward mode numbers to evaluate a
+    /// function and its derivatives at several points at once, i.e. the values
+    /// and derivatives are stored as structure of arrays over the points.
+    /// Arithmetic is applied per lane, comparisons yield a mask of type
+    /// Lanes<bool, Width> which can be reduced with any() and all() or used
+    /// in select().
+    /// @tparam _Scalar internal scalar type
+    /// @tparam _Width number of lanes
+    template<typename _Scalar, int _Width>
+    class Lanes
     {
-        return val * val;
-    }
+    public:
+        static_assert(_Width > 0, "Number of lanes must be positive");
 
-    template<typename Scalar>
-    inline Number<Scalar> log(const Number<Scalar> &val)
-    {
-        Scalar value = std::log(val.value());
-        Scalar derivative = val.derivative() * 1 / val.value();
-        return Number<Scalar>(value, derivative);
-    }
+        using Scalar = _Scalar;
+        using Index = std::size_t;
+        using Mask = Lanes<bool, _Width>;
+        static constexpr int Width = _Width;
 
-    template<typename Scalar>
-    inline Number<Scalar> log2(const Number<Scalar> &val)
-    {
-        Scalar value = std::log2(val.value());
-        Scalar derivative = val.derivative() * 1 / (val.value() * static_cast<Scalar>(0.6931471805599453));
-        return Number<Scalar>(value, derivative);
-    }
+        Lanes() = default;
 
-    template<typename Scalar>
-    inline bool isfinite(const Number<Scalar> &val)
-    {
-        return std::isfinite(val.value());
-    }
+        Lanes(const Scalar value)
+        {
+            for(Index i = 0; i < size(); ++i)
+                data_[i] = value;
+        }
 
-    typedef Number<double> Double;
-    typedef Number<float> Float;
-}
+        /// @brief Loads the lanes from the given contiguous array.
+        static Lanes<Scalar, _Width> load(const Scalar *values)
+        {
+            Lanes<Scalar, _Width> result;
+            for(Index i = 0; i < result.size(); ++i)
+                result[i] = values[i];
+            return result;
+        }
 
-namespace bwd
-{
-    template<typename Scalar>
-    class Expression
-    {
-    private:
-        std::string id_;
-        Scalar value_;
-    public:
-        Expression(const Scalar value)
-            : id_(), value_(value)
+        /// @brief Stores the lanes into the given contiguous array.
+        void store(Scalar *values) const
         {
-            std::stringstream ss;
-            ss << this;
-            id_ = ss.str();
+            for(Index i = 0; i < size(); ++i)
+                values[i] = data_[i];
         }
 
-        virtual ~Expression()
-        { }
+        Index size() const
+        {
+            return _Width;
+        }
 
-        virtual Scalar value() const
+        const Scalar &operator[](const Index i) const
         {
-            return value_;
+            return data_[i];
         }
 
-        virtual void derivative(std::map<std::string, Scalar> &map, const Scalar weight) const = 0;
+        Scalar &operator[](const Index i)
+        {
+            return data_[i];
+        }
 
-        const std::string &id() const
+        /// @brief Applies the given function to each lane.
+        template<typename Func>
+        auto map(Func &&func) const -> Lanes<decltype(func(std::declval<Scalar>())), _Width>
         {
-            return id_;
+            Lanes<decltype(func(std::declval<Scalar>())), _Width> result;
+            for(Index i = 0; i < size(); ++i)
+                result[i] = func(data_[i]);
+            return result;
         }
-    };
 
-    template<typename Scalar>
-    class UnaryExpression : public Expression<Scalar>
-    {
-    protected:
-        std::shared_ptr<Expression<Scalar>> expr_;
-    public:
-        UnaryExpression(const Scalar value,
-            const std::shared_ptr<Expression<Scalar>> &expr)
-            : Expression<Scalar>(value), expr_(expr)
-        { }
-    };
+        Lanes<Scalar, _Width> &operator+=(const Lanes<Scalar, _Width> &rhs)
+        {
+            for(Index i = 0; i < size(); ++i)
+                data_[i] += rhs.data_[i];
+            return *this;
+        }
 
-    template<typename Scalar>
-    class BinaryExpression : public Expression<Scalar>
-    {
-    protected:
-        std::shared_ptr<Expression<Scalar>> lhs_;
-        std::shared_ptr<Expression<Scalar>> rhs_;
-    public:
-        BinaryExpression(const Scalar value,
-            const std::shared_ptr<Expression<Scalar>> &lhs,
-            const std::shared_ptr<Expression<Scalar>> &rhs)
-            : Expression<Scalar>(value), lhs_(lhs), rhs_(rhs)
-        { }
-    };
+        Lanes<Scalar, _Width> &operator-=(const Lanes<Scalar, _Width> &rhs)
+        {
+            for(Index i = 0; i < size(); ++i)
+                data_[i] -= rhs.data_[i];
+            return *this;
+        }
 
-    template<typename Scalar>
-    class Parameter : public Expression<Scalar>
-    {
-    public:
-        Parameter(const Scalar value)
-            : Expression<Scalar>(value)
-        { }
+        Lanes<Scalar, _Width> &operator*=(const Lanes<Scalar, _Width> &rhs)
+        {
+            for(Index i = 0; i < size(); ++i)
+                data_[i] *= rhs.data_[i];
+            return *this;
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        Lanes<Scalar, _Width> &operator/=(const Lanes<Scalar, _Width> &rhs)
         {
-            const auto it = map.find(this->id());
-            if(it != map.end())
-                it->second += weight;
-            else
-                map[this->id()] = weight;
+            for(Index i = 0; i < size(); ++i)
+                data_[i] /= rhs.data_[i];
+            return *this;
         }
-    };
 
-    template<typename Scalar>
-    class Constant : public Expression<Scalar>
-    {
-    public:
-        Constant(const Scalar value)
-            : Expression<Scalar>(value)
-        { }
+        Lanes<Scalar, _Width> operator-() const
+        {
+            Lanes<Scalar, _Width> result;
+            for(Index i = 0; i < size(); ++i)
+                result[i] = -data_[i];
+            return result;
+        }
 
-        void derivative(std::map<std::string, Scalar> &,
-            const Scalar) const override
-        { }
-    };
+        Mask operator!() const
+        {
+            Mask result;
+            for(Index i = 0; i < size(); ++i)
+                result[i] = !data_[i];
+            return result;
+        }
 
-    template<typename Scalar>
-    class Negate : public UnaryExpression<Scalar>
-    {
-    public:
-        Negate(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(-expr->value(), expr)
-        { }
+        friend Lanes<Scalar, _Width> operator+(Lanes<Scalar, _Width> lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            lhs += rhs;
+            return lhs;
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        friend Lanes<Scalar, _Width> operator-(Lanes<Scalar, _Width> lhs, const Lanes<Scalar, _Width> &rhs)
         {
-            this->expr_->derivative(map, -weight);
+            lhs -= rhs;
+            return lhs;
         }
-    };
 
-    template<typename Scalar>
-    class Sin : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        Sin(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::sin(expr->value()), expr),
-            weight_(std::cos(expr->value()))
-        { }
+        friend Lanes<Scalar, _Width> operator*(Lanes<Scalar, _Width> lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            lhs *= rhs;
+            return lhs;
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        friend Lanes<Scalar, _Width> operator/(Lanes<Scalar, _Width> lhs, const Lanes<Scalar, _Width> &rhs)
         {
-            this->expr_->derivative(map, weight * weight_);
+            lhs /= rhs;
+            return lhs;
         }
-    };
 
-    template<typename Scalar>
-    class ArcSin : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        ArcSin(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::asin(expr->value()), expr),
-            weight_(1 / std::sqrt(1 - expr->value() * expr->value()))
-        { }
+        friend Mask operator==(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a == b; });
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        friend Mask operator!=(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
         {
-            this->expr_->derivative(map, weight * weight_);
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a != b; });
+        }
+
+        friend Mask operator<(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a < b; });
+        }
+
+        friend Mask operator<=(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a <= b; });
+        }
+
+        friend Mask operator>(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a > b; });
+        }
+
+        friend Mask operator>=(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a >= b; });
+        }
+
+        friend Mask operator&&(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a && b; });
+        }
+
+        friend Mask operator||(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs)
+        {
+            return compare(lhs, rhs, [](const Scalar a, const Scalar b) { return a || b; });
         }
-    };
 
-    template<typename Scalar>
-    class Cos : public UnaryExpression<Scalar>
-    {
     private:
-        Scalar weight_;
-    public:
-        Cos(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::cos(expr->value()), expr),
-            weight_(-std::sin(expr->value()))
-        { }
+        Scalar data_[_Width] = {};
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        template<typename Func>
+        static Mask compare(const Lanes<Scalar, _Width> &lhs, const Lanes<Scalar, _Width> &rhs, Func func)
         {
-            this->expr_->derivative(map, weight * weight_);
+            Mask result;
+            for(Index i = 0; i < lhs.size(); ++i)
+                result[i] = func(lhs[i], rhs[i]);
+            return result;
         }
     };
 
+    template<typename _Scalar, int _Width>
+    constexpr int Lanes<_Scalar, _Width>::Width;
+
     template<typename Scalar>
-    class ArcCos : public UnaryExpression<Scalar>
+    inline Scalar select(const bool mask, const Scalar a, const Scalar b)
     {
-    private:
-        Scalar weight_;
-    public:
-        ArcCos(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::acos(expr->value()), expr),
-            weight_(-1 / std::sqrt(1 - expr->value() * expr->value()))
-        { }
+        return mask ? a : b;
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> select(const Lanes<bool, Width> &mask,
+        const Lanes<Scalar, Width> &a,
+        const Lanes<Scalar, Width> &b)
+    {
+        Lanes<Scalar, Width> result;
+        for(std::size_t i = 0; i < result.size(); ++i)
+            result[i] = mask[i] ? a[i] : b[i];
+        return result;
+    }
+
+    inline bool any(const bool mask)
+    {
+        return mask;
+    }
+
+    inline bool all(const bool mask)
+    {
+        return mask;
+    }
+
+    template<int Width>
+    inline bool any(const Lanes<bool, Width> &mask)
+    {
+        bool result = false;
+        for(std::size_t i = 0; i < mask.size(); ++i)
+            result = result || mask[i];
+        return result;
+    }
+
+    template<int Width>
+    inline bool all(const Lanes<bool, Width> &mask)
+    {
+        bool result = true;
+        for(std::size_t i = 0; i < mask.size(); ++i)
+            result = result && mask[i];
+        return result;
+    }
+
+    template<typename Scalar, int Width>
+    inline std::ostream& operator<<(std::ostream &lhs, const Lanes<Scalar, Width> &rhs)
+    {
+        lhs << '[';
+        for(std::size_t i = 0; i < rhs.size(); ++i)
+            lhs << (i == 0 ? "" : " ") << rhs[i];
+        lhs << ']';
+        return lhs;
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> exp(const Lanes<Scalar, Width> &x)
+    {
+        return internal::math::apply(internal::math::Exp(), x);
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> log(const Lanes<Scalar, Width> &x)
+    {
+        return internal::math::apply(internal::math::Log(), x);
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> log2(const Lanes<Scalar, Width> &x)
+    {
+        return log(x) * Lanes<Scalar, Width>(static_cast<Scalar>(1.44269504088896340736));
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> sin(const Lanes<Scalar, Width> &x)
+    {
+        return internal::math::apply(internal::math::Sin(), x);
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> cos(const Lanes<Scalar, Width> &x)
+    {
+        return internal::math::apply(internal::math::Cos(), x);
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> tan(const Lanes<Scalar, Width> &x)
+    {
+        return sin(x) / cos(x);
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> sqrt(const Lanes<Scalar, Width> &x)
+    {
+        return x.map([](const Scalar v) { return std::sqrt(v); });
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> abs(const Lanes<Scalar, Width> &x)
+    {
+        return x.map([](const Scalar v) { return std::abs(v); });
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> asin(const Lanes<Scalar, Width> &x)
+    {
+        return x.map([](const Scalar v) { return std::asin(v); });
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> acos(const Lanes<Scalar, Width> &x)
+    {
+        return x.map([](const Scalar v) { return std::acos(v); });
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> atan(const Lanes<Scalar, Width> &x)
+    {
+        return x.map([](const Scalar v) { return std::atan(v); });
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> atan2(const Lanes<Scalar, Width> &y, const Lanes<Scalar, Width> &x)
+    {
+        Lanes<Scalar, Width> result;
+        for(std::size_t i = 0; i < result.size(); ++i)
+            result[i] = std::atan2(y[i], x[i]);
+        return result;
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> pow(const Lanes<Scalar, Width> &x, const Lanes<Scalar, Width> &exponent)
+    {
+        return exp(exponent * log(x));
+    }
+
+    template<typename Scalar, int Width>
+    inline Lanes<Scalar, Width> pow(const Lanes<Scalar, Width> &x, const typename Lanes<Scalar, Width>::Scalar exponent)
+    {
+        return x.map([exponent](const Scalar v) { return std::pow(v, exponent); });
+    }
+
+    /// @brief Raises all lanes to an integral power. The overload is limited
+    /// to integral exponents, so fractional ones are not truncated.
+    template<typename Scalar, int Width, typename Exponent>
+    inline typename std::enable_if<std::is_integral<Exponent>::value, Lanes<Scalar, Width>>::type
+    pow(const Lanes<Scalar, Width> &x, const Exponent exponent)
+    {
+        using Unsigned = typename std::make_unsigned<Exponent>::type;
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        // exponentiation by squaring is exact for negative bases as well
+        Lanes<Scalar, Width> result(1);
+        Lanes<Scalar, Width> base = exponent < 0 ? Lanes<Scalar, Width>(1) / x : x;
+        for(Unsigned e = exponent < 0 ? -static_cast<Unsigned>(exponent) : exponent; e != 0; e >>= 1)
         {
-            this->expr_->derivative(map, weight * weight_);
+            if(e & 1)
+                result *= base;
+            base *= base;
         }
-    };
+        return result;
+    }
 
-    template<typename Scalar>
-    class Tan : public UnaryExpression<Scalar>
+    template<typename Scalar, int Width>
+    inline typename Lanes<Scalar, Width>::Mask isfinite(const Lanes<Scalar, Width> &x)
+    {
+        return x.map([](const Scalar v) { return std::isfinite(v); });
+    }
+
+namespace fwd
+{
+    /// @brief Dimension of tangents whose size is only known at runtime.
+    constexpr int Dynamic = -1;
+
+    /// @brief Tangent vector of a forward mode number, i.e. its derivatives
+    /// in a fixed number of directions, which are stored contiguously.
+    /// @tparam _Scalar internal scalar type
+    /// @tparam _Dim number of directions
+    template<typename _Scalar, int _Dim>
+    class Tangent
     {
-    private:
-        Scalar weight_;
     public:
-        Tan(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::tan(expr->value()), expr),
-            weight_()
+        static_assert(_Dim > 0, "Tangent dimension must be positive or Dynamic");
+
+        using Scalar = _Scalar;
+        using Index = std::size_t;
+        static constexpr int Dim = _Dim;
+
+        Tangent() = default;
+
+        explicit Tangent(const Scalar value)
         {
-            Scalar c = std::cos(expr->value());
-            weight_ = 1 / (c * c);
+            for(Index i = 0; i < size(); ++i)
+                data_[i] = value;
         }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Returns the tangent which is one in the given direction and
+        /// zero otherwise.
+        static Tangent<Scalar, _Dim> Unit(const Index direction)
         {
-            this->expr_->derivative(map, weight * weight_);
+            assert(direction < Index{Dim});
+            Tangent<Scalar, _Dim> result;
+            result[direction] = 1;
+            return result;
         }
-    };
 
-    template<typename Scalar>
-    class ArcTan : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        ArcTan(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::atan(expr->value()), expr),
-            weight_(1 / (1 + expr->value() * expr->value()))
-        { }
+        Index size() const
+        {
+            return Dim;
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        Scalar *data()
         {
-            this->expr_->derivative(map, weight * weight_);
+            return data_;
         }
-    };
 
-    template<typename Scalar>
-    class ArcTan2 : public BinaryExpression<Scalar>
-    {
-    private:
-        Scalar weightLhs_;
-        Scalar weightRhs_;
-    public:
-        ArcTan2(const std::shared_ptr<Expression<Scalar>> &lhs,
-            const std::shared_ptr<Expression<Scalar>> &rhs)
-            : BinaryExpression<Scalar>(std::atan2(lhs->value(), rhs->value()), lhs, rhs),
-            weightLhs_(), weightRhs_()
+        const Scalar *data() const
         {
-            Scalar denom = rhs->value() * rhs->value() + lhs->value() * lhs->value();
-            weightLhs_ = rhs->value() / denom;
-            weightRhs_ = lhs->value() / denom;
+            return data_;
         }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        Scalar operator[](const Index i) const
         {
-            this->lhs_->derivative(map, weight * weightLhs_);
-            this->rhs_->derivative(map, weight * weightRhs_);
+            return data_[i];
         }
-    };
 
-    template<typename Scalar>
-    class Exp : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        Exp(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::exp(expr->value()), expr),
-            weight_(this->value())
-        { }
+        Scalar &operator[](const Index i)
+        {
+            return data_[i];
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Computes this = a * this + b * rhs.
+        void combine(const Scalar a, const Scalar b, const Tangent<Scalar, _Dim> &rhs)
         {
-            this->expr_->derivative(map, weight * weight_);
+            internal::axpby(size(), b, rhs.data(), a, data());
         }
-    };
 
-    template<typename Scalar>
-    class Sqrt : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        Sqrt(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::sqrt(expr->value()), expr),
-            weight_(1 / (2 * this->value()))
-        { }
+        /// @brief Returns a * this.
+        Tangent<Scalar, _Dim> scaled(const Scalar a) const
+        {
+            Tangent<Scalar, _Dim> result;
+            internal::scale(size(), a, data(), result.data());
+            return result;
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Returns the element-wise absolute value of this tangent.
+        Tangent<Scalar, _Dim> cwiseAbs() const
         {
-            this->expr_->derivative(map, weight * weight_);
+            Tangent<Scalar, _Dim> result;
+            internal::abs(size(), data(), result.data());
+            return result;
         }
-    };
 
-    template<typename Scalar>
-    class Abs : public UnaryExpression<Scalar>
-    {
-    public:
-        Abs(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::abs(expr->value()), expr)
-        { }
+        Tangent<Scalar, _Dim> &operator+=(const Tangent<Scalar, _Dim> &rhs)
+        {
+            internal::axpy(size(), Scalar{1}, rhs.data(), data());
+            return *this;
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        Tangent<Scalar, _Dim> &operator-=(const Tangent<Scalar, _Dim> &rhs)
         {
-            this->expr_->derivative(map, std::abs(weight));
+            internal::axpy(size(), Scalar{-1}, rhs.data(), data());
+            return *this;
         }
+
+    private:
+        Scalar data_[Dim] = {};
     };
 
-    template<typename Scalar>
-    class Abs2 : public UnaryExpression<Scalar>
+    template<typename _Scalar, int _Dim>
+    constexpr int Tangent<_Scalar, _Dim>::Dim;
+
+    /// @brief Tangent vector whose number of directions is determined at runtime.
+    /// An empty tangent is treated as zero in all directions, so constants do
+    /// not have to allocate.
+    /// @tparam _Scalar internal scalar type
+    template<typename _Scalar>
+    class Tangent<_Scalar, Dynamic>
     {
-    private:
-        Scalar weight_;
     public:
-        Abs2(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(expr->value() * expr->value(), expr),
-            weight_(2 * expr->value())
+        using Scalar = _Scalar;
+        using Index = std::size_t;
+        static constexpr int Dim = Dynamic;
+
+        Tangent() = default;
+
+        Tangent(const Index size, const Scalar value)
+            : data_(size, value)
         { }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Returns the tangent of the given size which is one in the
+        /// given direction and zero otherwise.
+        static Tangent<Scalar, Dynamic> Unit(const Index size, const Index direction)
         {
-            this->expr_->derivative(map, weight * weight_);
+            assert(direction < size);
+            Tangent<Scalar, Dynamic> result(size, 0);
+            result[direction] = 1;
+            return result;
         }
-    };
 
-    template<typename Scalar>
-    class Log : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        Log(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::log(expr->value()), expr),
-            weight_(1 / expr->value())
-        { }
+        Index size() const
+        {
+            return data_.size();
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        Scalar *data()
         {
-            this->expr_->derivative(map, weight * weight_);
+            return data_.data();
+        }
+
+        const Scalar *data() const
+        {
+            return data_.data();
+        }
+
+        Scalar operator[](const Index i) const
+        {
+            return data_[i];
+        }
+
+        Scalar &operator[](const Index i)
+        {
+            return data_[i];
+        }
+
+        /// @brief Computes this = a * this + b * rhs.
+        void combine(const Scalar a, const Scalar b, const Tangent<Scalar, Dynamic> &rhs)
+        {
+            if(rhs.size() == 0)
+            {
+                internal::scale(size(), a, data(), data());
+            }
+            else if(size() == 0)
+            {
+                data_.resize(rhs.size());
+                internal::scale(size(), b, rhs.data(), data());
+            }
+            else
+            {
+                assert(size() == rhs.size());
+                internal::axpby(size(), b, rhs.data(), a, data());
+            }
+        }
+
+        /// @brief Returns a * this.
+        Tangent<Scalar, Dynamic> scaled(const Scalar a) const
+        {
+            Tangent<Scalar, Dynamic> result(size(), 0);
+            internal::scale(size(), a, data(), result.data());
+            return result;
+        }
+
+        /// @brief Returns the element-wise absolute value of this tangent.
+        Tangent<Scalar, Dynamic> cwiseAbs() const
+        {
+            Tangent<Scalar, Dynamic> result(size(), 0);
+            internal::abs(size(), data(), result.data());
+            return result;
+        }
+
+        Tangent<Scalar, Dynamic> &operator+=(const Tangent<Scalar, Dynamic> &rhs)
+        {
+            combine(1, 1, rhs);
+            return *this;
+        }
+
+        Tangent<Scalar, Dynamic> &operator-=(const Tangent<Scalar, Dynamic> &rhs)
+        {
+            combine(1, -1, rhs);
+            return *this;
         }
-    };
 
-    template<typename Scalar>
-    class Log2 : public UnaryExpression<Scalar>
-    {
     private:
-        Scalar weight_;
-    public:
-        Log2(const std::shared_ptr<Expression<Scalar>> &expr)
-            : UnaryExpression<Scalar>(std::log2(expr->value()), expr),
-            weight_(1 / (expr->value() * std::log(Scalar{2})))
-        { }
+        std::vector<Scalar> data_;
+    };
+
+    template<typename _Scalar>
+    constexpr int Tangent<_Scalar, Dynamic>::Dim;
+
+    /// @brief Generic number type for computing derivate in forward mode.
+    /// The number propagates its derivatives in _Dim directions at once.
+    /// @tparam _Scalar internal scalar type
+    /// @tparam _Dim number of directions, may be Dynamic
+    template<typename _Scalar, int _Dim = 1>
+    class Number
+    {
+    public:
+        using Scalar = _Scalar;
+        using Derivative = Tangent<Scalar, _Dim>;
+        using Index = typename Derivative::Index;
+        static constexpr int Dim = _Dim;
+
+        Number() = default;
+        Number(const Number<Scalar, _Dim> &rhs) = default;
+        Number(Number<Scalar, _Dim> &&rhs) = default;
+        ~Number() = default;
+
+        Number(const Scalar value)
+            : value_(value)
+        { }
+
+        Number(const Scalar value, const Scalar derivative)
+            : value_(value)
+        {
+            static_assert(Dim == 1, "Scalar derivatives require a one dimensional tangent");
+            derivative_[0] = derivative;
+        }
+
+        Number(const Scalar value, const Derivative &derivative)
+            : value_(value), derivative_(derivative)
+        { }
+
+        Scalar value() const
+        {
+            return value_;
+        }
+
+        Scalar derivative() const
+        {
+            static_assert(Dim == 1, "Scalar derivatives require a one dimensional tangent");
+            return derivative_[0];
+        }
+
+        /// @brief Returns the derivative in the given direction.
+        Scalar derivative(const Index direction) const
+        {
+            return direction < derivative_.size() ? derivative_[direction] : Scalar{0};
+        }
+
+        /// @brief Returns the derivatives in all directions.
+        const Derivative &tangent() const
+        {
+            return derivative_;
+        }
+
+        Number<Scalar, _Dim> &operator=(const Number<Scalar, _Dim> &rhs) & = default;
+        Number<Scalar, _Dim> &operator=(Number<Scalar, _Dim> &&rhs) & = default;
+
+        Number<Scalar, _Dim> &operator=(const Scalar rhs) &
+        {
+            value_ = rhs;
+            derivative_ = Derivative();
+
+            return *this;
+        }
+
+        Number<Scalar, _Dim> &operator+=(const Number<Scalar, _Dim> &rhs)
+        {
+            value_ += rhs.value_;
+            derivative_ += rhs.derivative_;
+
+            return *this;
+        }
+
+        Number<Scalar, _Dim> &operator*=(const Number<Scalar, _Dim> &rhs)
+        {
+            derivative_.combine(rhs.value_, value_, rhs.derivative_);
+            value_ *= rhs.value_;
+
+            return *this;
+        }
+
+        Number<Scalar, _Dim> &operator-=(const Number<Scalar, _Dim> &rhs)
+        {
+            value_ -= rhs.value_;
+            derivative_ -= rhs.derivative_;
+
+            return *this;
+        }
+
+        Number<Scalar, _Dim> &operator/=(const Number<Scalar, _Dim> &rhs)
+        {
+            derivative_.combine(1 / rhs.value_, -value_ / (rhs.value_ * rhs.value_), rhs.derivative_);
+            value_ /= rhs.value_;
+
+            return *this;
+        }
+
+        Number<Scalar, _Dim> operator-() const
+        {
+            return Number<Scalar, _Dim>(-value_, derivative_.scaled(-1));
+        }
+
+        /// @brief Returns the number f(x) with value f(value()) and derivative
+        /// f'(value()) * derivative(), i.e. applies the chain rule.
+        Number<Scalar, _Dim> chain(const Scalar value, const Scalar weight) const
+        {
+            return Number<Scalar, _Dim>(value, derivative_.scaled(weight));
+        }
+
+        explicit operator Scalar() const
+        {
+            return value();
+        }
+
+    private:
+        Scalar value_{0};
+        Derivative derivative_;
+    };
+
+    template<typename _Scalar, int _Dim>
+    constexpr int Number<_Scalar, _Dim>::Dim;
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator+(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        auto result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator-(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        auto result = lhs;
+        result -= rhs;
+        return result;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator/(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        auto result = lhs;
+        result /= rhs;
+        return result;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator*(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        auto result = lhs;
+        result *= rhs;
+        return result;
+    }
+
+    template<typename Scalar, int Dim>
+    inline auto operator==(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+        -> decltype(lhs.value() == rhs.value())
+    {
+        return lhs.value() == rhs.value();
+    }
+
+    template<typename Scalar, int Dim>
+    inline auto operator!=(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+        -> decltype(lhs.value() != rhs.value())
+    {
+        return lhs.value() != rhs.value();
+    }
+
+    template<typename Scalar, int Dim>
+    inline auto operator<(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+        -> decltype(lhs.value() < rhs.value())
+    {
+        return lhs.value() < rhs.value();
+    }
+
+    template<typename Scalar, int Dim>
+    inline auto operator<=(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+        -> decltype(lhs.value() <= rhs.value())
+    {
+        return lhs.value() <= rhs.value();
+    }
+
+    template<typename Scalar, int Dim>
+    inline auto operator>(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+        -> decltype(lhs.value() > rhs.value())
+    {
+        return lhs.value() > rhs.value();
+    }
+
+    template<typename Scalar, int Dim>
+    inline auto operator>=(const Number<Scalar, Dim> &lhs, const Number<Scalar, Dim> &rhs)
+        -> decltype(lhs.value() >= rhs.value())
+    {
+        return lhs.value() >= rhs.value();
+    }
+
+    template<typename Scalar, int Dim>
+    inline std::ostream& operator<<(std::ostream &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        lhs << '(' << rhs.value();
+        for(std::size_t i = 0; i < rhs.tangent().size(); ++i)
+            lhs << ',' << rhs.tangent()[i];
+        lhs << ')';
+        return lhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Scalar &operator+=(Scalar &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        lhs += rhs.value();
+        return lhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator+(const Scalar lhs, const Number<Scalar, Dim> &rhs)
+    {
+        return Number<Scalar, Dim>(lhs) + rhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Scalar &operator-=(Scalar &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        lhs -= rhs.value();
+        return lhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator-(const Scalar lhs, const Number<Scalar, Dim> &rhs)
+    {
+        return Number<Scalar, Dim>(lhs) - rhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Scalar &operator*=(Scalar &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        lhs *= rhs.value();
+        return lhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator*(const Scalar lhs, const Number<Scalar, Dim> &rhs)
+    {
+        return Number<Scalar, Dim>(lhs) * rhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Scalar &operator/=(Scalar &lhs, const Number<Scalar, Dim> &rhs)
+    {
+        lhs /= rhs.value();
+        return lhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> operator/(const Scalar lhs, const Number<Scalar, Dim> &rhs)
+    {
+        return Number<Scalar, Dim>(lhs) / rhs;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> sin(const Number<Scalar, Dim> &val)
+    {
+        using std::sin;
+        using std::cos;
+        return val.chain(sin(val.value()), cos(val.value()));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> asin(const Number<Scalar, Dim> &val)
+    {
+        using std::asin;
+        using std::sqrt;
+        return val.chain(asin(val.value()), 1 / sqrt(1 - val.value() * val.value()));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> cos(const Number<Scalar, Dim> &val)
+    {
+        using std::sin;
+        using std::cos;
+        return val.chain(cos(val.value()), -sin(val.value()));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> acos(const Number<Scalar, Dim> &val)
+    {
+        using std::acos;
+        using std::sqrt;
+        return val.chain(acos(val.value()), -1 / sqrt(1 - val.value() * val.value()));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> tan(const Number<Scalar, Dim> &val)
+    {
+        using std::tan;
+        using std::cos;
+        Scalar c = cos(val.value());
+        return val.chain(tan(val.value()), 1 / (c * c));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> atan(const Number<Scalar, Dim> &val)
+    {
+        using std::atan;
+        return val.chain(atan(val.value()), 1 / (1 + val.value() * val.value()));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> atan2(const Number<Scalar, Dim> &y, const Number<Scalar, Dim> &x)
+    {
+        using std::atan2;
+        Scalar value = atan2(y.value(), x.value());
+        Scalar denom = x.value() * x.value() + y.value() * y.value();
+        auto derivative = x.tangent().scaled(y.value() / denom);
+        derivative.combine(1, x.value() / denom, y.tangent());
+
+        return Number<Scalar, Dim>(value, derivative);
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> exp(const Number<Scalar, Dim> &val)
+    {
+        using std::exp;
+        Scalar value = exp(val.value());
+        return val.chain(value, value);
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> pow(const Number<Scalar, Dim> &val, const Scalar exponent)
+    {
+        using std::pow;
+        return val.chain(pow(val.value(), exponent),
+            exponent * pow(val.value(), exponent - 1));
+    }
+
+    /// @brief Raises numbers over lanes to a power which is shared by all
+    /// lanes.
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> pow(const Number<Scalar, Dim> &val, const typename Scalar::Scalar exponent)
+    {
+        using std::pow;
+        return val.chain(pow(val.value(), exponent),
+            exponent * pow(val.value(), exponent - 1));
+    }
+
+    template<typename Scalar, int Dim, typename Exponent>
+    inline typename std::enable_if<std::is_integral<Exponent>::value, Number<Scalar, Dim>>::type
+    pow(const Number<Scalar, Dim> &val, const Exponent exponent)
+    {
+        using std::pow;
+        return val.chain(pow(val.value(), exponent),
+            exponent * pow(val.value(), exponent - 1));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> sqrt(const Number<Scalar, Dim> &val)
+    {
+        using std::sqrt;
+        Scalar value = sqrt(val.value());
+        return val.chain(value, 1 / (2 * value));
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> conj(const Number<Scalar, Dim> &val)
+    {
+        return val;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> real(const Number<Scalar, Dim> &val)
+    {
+        return val;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> imag(const Number<Scalar, Dim> &)
+    {
+        return Number<Scalar, Dim>(0);
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> abs(const Number<Scalar, Dim> &val)
+    {
+        using std::abs;
+        return Number<Scalar, Dim>(abs(val.value()), val.tangent().cwiseAbs());
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> abs2(const Number<Scalar, Dim> &val)
+    {
+        return val * val;
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> log(const Number<Scalar, Dim> &val)
+    {
+        using std::log;
+        return val.chain(log(val.value()), 1 / val.value());
+    }
+
+    template<typename Scalar, int Dim>
+    inline Number<Scalar, Dim> log2(const Number<Scalar, Dim> &val)
+    {
+        using std::log2;
+        return val.chain(log2(val.value()),
+            1 / (val.value() * static_cast<Scalar>(0.6931471805599453)));
+    }
+
+    template<typename Scalar, int Dim>
+    inline auto isfinite(const Number<Scalar, Dim> &val) -> decltype(std::isfinite(val.value()))
+    {
+        using std::isfinite;
+        return isfinite(val.value());
+    }
+
+    /// @brief Selects a if mask is set and b otherwise. For numbers over lanes
+    /// the selection is done per lane.
+    template<typename Mask, typename Scalar, int Dim>
+    inline Number<Scalar, Dim> select(const Mask &mask,
+        const Number<Scalar, Dim> &a,
+        const Number<Scalar, Dim> &b)
+    {
+        auto derivative = a.tangent().size() >= b.tangent().size() ? a.tangent() : b.tangent();
+        for(std::size_t i = 0; i < derivative.size(); ++i)
+            derivative[i] = adcpp::select(mask, a.derivative(i), b.derivative(i));
+        return Number<Scalar, Dim>(adcpp::select(mask, a.value(), b.value()), derivative);
+    }
+
+    /// @brief Evaluates a function with several inputs and outputs whose
+    /// values and Jacobian are computed by the given callback instead of
+    /// being traced through scalar operations. The tangents of the outputs
+    /// are the product of the Jacobian with the tangents of the inputs.
+    /// @param function callable function(inputs, outputs, jacobian) which
+    /// stores the values of the outputs and the row major Jacobian with one
+    /// row per output
+    /// @param inputs arguments of the function
+    /// @param outputCount number of outputs of the function
+    template<typename Function, typename Scalar, int Dim>
+    inline std::vector<Number<Scalar, Dim>> customFunction(const Function &function,
+        const std::vector<Number<Scalar, Dim>> &inputs,
+        const std::size_t outputCount)
+    {
+        const std::size_t inputCount = inputs.size();
+        std::vector<Scalar> values(inputCount + outputCount);
+        std::vector<Scalar> jacobian(outputCount * inputCount);
+        for(std::size_t j = 0; j < inputCount; ++j)
+            values[j] = inputs[j].value();
+        function(values.data(), values.data() + inputCount, jacobian.data());
+
+        std::vector<Number<Scalar, Dim>> outputs;
+        outputs.reserve(outputCount);
+        for(std::size_t i = 0; i < outputCount; ++i)
+        {
+            typename Number<Scalar, Dim>::Derivative derivative;
+            for(std::size_t j = 0; j < inputCount; ++j)
+                derivative.combine(1, jacobian[i * inputCount + j], inputs[j].tangent());
+            outputs.emplace_back(values[inputCount + i], derivative);
+        }
+        return outputs;
+    }
+
+    /// @brief Evaluates a function with several inputs and outputs whose
+    /// values and vector Jacobian products are computed by the given
+    /// callbacks, e.g. a kernel written for backward mode. The Jacobian is
+    /// assembled from one product per output.
+    /// @param value callable value(inputs, outputs) which stores the values
+    /// of the outputs
+    /// @param adjoint callable adjoint(inputs, outputs, outputAdjoints,
+    /// inputAdjoints) which stores the product of the transposed Jacobian
+    /// with the output adjoints
+    template<typename Value, typename Adjoint, typename Scalar, int Dim>
+    inline std::vector<Number<Scalar, Dim>> customFunction(const Value &value,
+        const Adjoint &adjoint,
+        const std::vector<Number<Scalar, Dim>> &inputs,
+        const std::size_t outputCount)
+    {
+        const std::size_t inputCount = inputs.size();
+        std::vector<Scalar> seed(outputCount);
+        return customFunction([&](const Scalar *x, Scalar *y, Scalar *jacobian)
+        {
+            value(x, y);
+            for(std::size_t i = 0; i < outputCount; ++i)
+            {
+                std::fill(seed.begin(), seed.end(), Scalar{0});
+                seed[i] = 1;
+                adjoint(x, y, seed.data(), jacobian + i * inputCount);
+            }
+        }, inputs, outputCount);
+    }
+
+    typedef Number<double> Double;
+    typedef Number<float> Float;
+
+    typedef Number<double, Dynamic> DoubleX;
+    typedef Number<float, Dynamic> FloatX;
+}
+
+namespace bwd
+{
+    /// @brief Operations which can be recorded on a backward mode tape.
+    enum class Operation : unsigned char
+    {
+        Parameter,
+        Constant,
+        Negate,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        AddScalar,
+        SubtractScalar,
+        ScalarSubtract,
+        MultiplyScalar,
+        DivideScalar,
+        ScalarDivide,
+        Sin,
+        ArcSin,
+        Cos,
+        ArcCos,
+        Tan,
+        ArcTan,
+        ArcTan2,
+        Exp,
+        Sqrt,
+        Abs,
+        Abs2,
+        Log,
+        Log2,
+        Pow,
+        PowInt,
+        Sum,
+        Dot,
+        SquaredNorm,
+        External,
+        Output
+    };
+
+    /// @brief Comparisons of backward mode numbers which are recorded on the
+    /// tape, since their outcome may determine the recorded operations.
+    enum class Comparison : unsigned char
+    {
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual
+    };
+
+    /// @brief Linear tape which records the operations of backward mode numbers.
+    ///
+    /// Every operation is stored as a statement holding its value, the indices
+    /// of its operands and the local partial derivatives w.r.t. these operands.
+    /// Parameters are numbered densely in the order they are recorded; their
+    /// statements store this parameter index as left hand side operand.
+    /// N-ary statements (Sum, Dot, SquaredNorm) keep their operands and
+    /// partial derivatives in a separate operand list; their statements store
+    /// the offset into this list as left and the number of operands as right
+    /// hand side operand.
+    /// External statements stand for a Function with several inputs and
+    /// outputs, e.g. a matrix operation. Their inputs are kept in the operand
+    /// list as well and their outputs are recorded as Output statements right
+    /// after them.
+    /// Statements live in fixed size chunks. Resetting the tape only rewinds
+    /// its size, so the chunks are reused by subsequent evaluations. Chunks
+    /// are taken from a pool which is shared by several tapes, by default all
+    /// tapes created by the same thread, and are returned to it when a tape
+    /// is cleared or destroyed.
+    ///
+    /// A recorded tape can be replayed at new parameter values, which
+    /// recomputes all values and partial derivatives without recording
+    /// anything. Comparisons of numbers are recorded as well, so a replay can
+    /// detect when the control flow of the recorded function would change.
+    ///
+    /// The tape counts the numbers which refer to it and resets itself
+    /// automatically once the last of them is destroyed. The count is only
+    /// atomic if ADCPP_THREAD_SAFE is defined, which allows to copy and
+    /// destroy numbers of a tape concurrently. Recording on the same tape
+    /// from several threads is never safe, but every thread records on its
+    /// own active tape.
+    /// @tparam _Scalar internal scalar type
+    template<typename _Scalar>
+    class Tape
+    {
+    public:
+        using Scalar = _Scalar;
+        using Index = std::size_t;
+
+        /// @brief Operand index of statements which have no such operand.
+        static constexpr Index None = static_cast<Index>(-1);
+
+        struct Statement
+        {
+            Operation op;
+            Index lhs;
+            Index rhs;
+            Scalar value;
+            Scalar weightLhs;
+            Scalar weightRhs;
+        };
+
+        /// @brief Operand of an n-ary statement and the partial derivative
+        /// w.r.t. it.
+        struct Operand
+        {
+            Index index;
+            Scalar weight;
+        };
+
+        /// @brief Statistics of an optimization of the tape, see optimize().
+        struct Optimization
+        {
+            /// Number of statements before the optimization.
+            Index before;
+            /// Number of statements after the optimization.
+            Index after;
+            /// Number of statements which were folded into constants.
+            Index folded;
+            /// Number of statements which were replaced by an equivalent one.
+            Index merged;
+        };
+
+        /// @brief Entry of a sparse Hessian, see hessian().
+        struct HessianEntry
+        {
+            Index row;
+            Index col;
+            Scalar value;
+        };
+
+        /// @brief Recorded comparison of two statements.
+        struct Condition
+        {
+            Comparison comparison;
+            bool outcome;
+            Index lhs;
+            Index rhs;
+            /// Size of the tape when the comparison was recorded.
+            Index position;
+        };
+
+        using Chunk = std::unique_ptr<Statement[]>;
+
+        /// @brief Operation with several inputs and outputs whose values and
+        /// adjoints are computed by the caller instead of the tape, e.g. a
+        /// matrix operation which would otherwise be recorded as a huge
+        /// number of scalar statements.
+        class Function
+        {
+        public:
+            virtual ~Function() = default;
+
+            /// @brief Computes the values of the outputs from the values of
+            /// the inputs. Called once when the function is recorded and
+            /// again on every replay; may keep whatever adjoint() needs.
+            virtual void evaluate(const Scalar *inputs, Scalar *outputs) = 0;
+
+            /// @brief Adds the product of the given output adjoints and the
+            /// Jacobian of the last evaluation to the given input adjoints.
+            virtual void adjoint(const Scalar *outputs, Scalar *inputs) const = 0;
+
+            /// @brief Stores the product of the Jacobian of the last
+            /// evaluation with the given input tangents in outputs. Returns
+            /// false if the function does not provide second order
+            /// derivatives, see curvature().
+            virtual bool tangent(const Scalar *, Scalar *) const
+            {
+                return false;
+            }
+
+            /// @brief Adds the product of the sum of the output Hessians,
+            /// weighted by the given output adjoints, with the given input
+            /// tangents to inputs. Only needed for second order derivatives
+            /// of statements which depend on the function.
+            virtual void curvature(const Scalar *, const Scalar *, Scalar *) const
+            {
+                throw std::logic_error("second order derivatives of functions are not supported");
+            }
+        };
+
+        /// @brief Pool of statement chunks which can be shared by several
+        /// tapes. Chunks are kept when a tape returns them, so creating and
+        /// destroying tapes does not allocate once the pool has grown large
+        /// enough.
+        class Pool
+        {
+        public:
+            Pool() = default;
+            Pool(const Pool &rhs) = delete;
+            Pool &operator=(const Pool &rhs) = delete;
+
+            /// @brief Returns the default pool of the calling thread.
+            static std::shared_ptr<Pool> local()
+            {
+                static thread_local std::shared_ptr<Pool> pool = std::make_shared<Pool>();
+                return pool;
+            }
+
+            Chunk acquire()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(cached_.empty())
+                {
+                    allocated_ += ChunkSize;
+                    return Chunk(new Statement[ChunkSize]);
+                }
+
+                auto chunk = std::move(cached_.back());
+                cached_.pop_back();
+                return chunk;
+            }
+
+            void release(Chunk &&chunk)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cached_.push_back(std::move(chunk));
+            }
+
+            /// @brief Frees all chunks which are currently not used by any tape.
+            void trim()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                allocated_ -= cached_.size() * ChunkSize;
+                cached_.clear();
+                cached_.shrink_to_fit();
+            }
+
+            /// @brief Returns the number of statements allocated by this pool,
+            /// which are either used by tapes or cached for reuse.
+            Index allocated() const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return allocated_;
+            }
+
+            /// @brief Returns the number of statements which are cached for reuse.
+            Index cached() const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return cached_.size() * ChunkSize;
+            }
+
+            /// @brief Returns the number of bytes held by the allocated statements.
+            std::size_t bytes() const
+            {
+                return allocated() * sizeof(Statement);
+            }
+
+        private:
+            mutable std::mutex mutex_;
+            std::vector<Chunk> cached_;
+            Index allocated_ = 0;
+        };
+
+        Tape()
+            : Tape(Pool::local())
+        { }
+
+        /// @brief Creates a tape which takes its chunks from the given pool.
+        explicit Tape(const std::shared_ptr<Pool> &pool)
+            : pool_(pool)
+        { }
+
+        Tape(const Tape<Scalar> &rhs) = delete;
+        Tape(Tape<Scalar> &&rhs) = delete;
+
+        ~Tape()
+        {
+            releaseChunks();
+        }
+
+        Tape<Scalar> &operator=(const Tape<Scalar> &rhs) = delete;
+        Tape<Scalar> &operator=(Tape<Scalar> &&rhs) = delete;
+
+        /// @brief Returns the pool from which this tape takes its chunks.
+        const Pool &pool() const
+        {
+            return *pool_;
+        }
+
+        /// @brief Makes a tape the active tape of the calling thread for the
+        /// lifetime of this object, e.g. to record a function on a separate
+        /// tape. Scopes can be nested.
+        class ActiveScope
+        {
+        public:
+            explicit ActiveScope(Tape<Scalar> &tape)
+                : previous_(current())
+            {
+                current() = &tape;
+            }
+
+            ActiveScope(const ActiveScope &rhs) = delete;
+            ActiveScope &operator=(const ActiveScope &rhs) = delete;
+
+            ~ActiveScope()
+            {
+                current() = previous_;
+            }
+
+        private:
+            Tape<Scalar> *previous_;
+        };
+
+        /// @brief Returns the tape on which new numbers are recorded by the
+        /// calling thread. Every thread has its own active tape, unless an
+        /// ActiveScope selects another one.
+        static Tape<Scalar> &active()
+        {
+            static thread_local Tape<Scalar> tape;
+            Tape<Scalar> *scoped = current();
+            return scoped != nullptr ? *scoped : tape;
+        }
+
+        /// @brief Returns the number of recorded statements.
+        Index size() const
+        {
+            return size_;
+        }
+
+        /// @brief Returns the number of calls of optimize(), which moves the
+        /// statements of all numbers except for parameters.
+        Index generation() const
+        {
+            return generation_;
+        }
+
+        /// @brief Returns the number of allocated statements, i.e. the
+        /// capacity of all chunks held by this tape.
+        Index capacity() const
+        {
+            return chunks_.size() * ChunkSize;
+        }
+
+        const Statement &operator[](const Index index) const
+        {
+            return chunks_[index >> ChunkBits][index & ChunkMask];
+        }
+
+        Statement &operator[](const Index index)
+        {
+            return chunks_[index >> ChunkBits][index & ChunkMask];
+        }
+
+        /// @brief Discards all statements, but keeps the allocated chunks.
+        /// Numbers recorded on this tape must not be used afterwards.
+        void reset()
+        {
+            reset(0);
+        }
+
+        /// @brief Discards all statements from the given position onward, but
+        /// keeps the allocated chunks.
+        /// Numbers recorded at or after this position must not be used afterwards.
+        void reset(const Index position)
+        {
+            assert(position <= size_);
+            size_ = position;
+            while(!parameters_.empty() && parameters_.back() >= position)
+                parameters_.pop_back();
+            while(!conditions_.empty() && conditions_.back().position > position)
+                conditions_.pop_back();
+            while(!naries_.empty() && naries_.back() >= position)
+            {
+                operands_.resize((*this)[naries_.back()].lhs);
+                naries_.pop_back();
+            }
+            while(!functions_.empty() && functions_.back().index >= position)
+                functions_.pop_back();
+        }
+
+        /// @brief Returns all chunks of this tape to its pool.
+        /// Numbers recorded on this tape must not be used afterwards.
+        void clear()
+        {
+            size_ = 0;
+            releaseChunks();
+            parameters_.clear();
+            parameters_.shrink_to_fit();
+            conditions_.clear();
+            conditions_.shrink_to_fit();
+            operands_.clear();
+            operands_.shrink_to_fit();
+            naries_.clear();
+            naries_.shrink_to_fit();
+            functions_.clear();
+            functions_.shrink_to_fit();
+            adjoints_.clear();
+            adjoints_.shrink_to_fit();
+            tangents_.clear();
+            tangents_.shrink_to_fit();
+            tangentAdjoints_.clear();
+            tangentAdjoints_.shrink_to_fit();
+            secondAdjoints_.clear();
+            secondAdjoints_.shrink_to_fit();
+        }
+
+        /// @brief Returns the number of recorded parameters.
+        Index parameterCount() const
+        {
+            return parameters_.size();
+        }
+
+        Index parameter(const Scalar value)
+        {
+            const auto index = push(Operation::Parameter, value, parameters_.size(), 0, None, 0);
+            parameters_.push_back(index);
+            return index;
+        }
+
+        Index constant(const Scalar value)
+        {
+            return push(Operation::Constant, value, None, 0, None, 0);
+        }
+
+        /// @brief Returns the statement index of the parameter with the given
+        /// parameter index.
+        Index parameterIndex(const Index parameter) const
+        {
+            return parameters_[parameter];
+        }
+
+        /// @brief Records a unary operation and computes its value and partial
+        /// derivative. Operations with an additional scalar argument, e.g. the
+        /// exponent of Pow or the scalar operand of MultiplyScalar, keep it in
+        /// the otherwise unused weightRhs.
+        Index record(const Operation op,
+            const Index operand,
+            const Scalar argument = 0)
+        {
+            const auto index = push(op, 0, operand, 0, None, argument);
+            evaluate((*this)[index]);
+            return index;
+        }
+
+        /// @brief Records a binary operation and computes its value and
+        /// partial derivatives.
+        Index record(const Operation op,
+            const Index lhs,
+            const Index rhs)
+        {
+            const auto index = push(op, 0, lhs, 0, rhs, 0);
+            evaluate((*this)[index]);
+            return index;
+        }
+
+        /// @brief Adds an operand to the n-ary statement which is recorded next.
+        void operand(const Index index)
+        {
+            operands_.push_back({index, Scalar{0}});
+        }
+
+        /// @brief Records an n-ary operation on all operands which were added
+        /// since the last n-ary statement and computes its value and partial
+        /// derivatives. Dot expects the operands of the left hand side vector
+        /// followed by the ones of the right hand side vector.
+        Index recordNary(const Operation op)
+        {
+            const Index offset = naries_.empty() ? 0 : (*this)[naries_.back()].lhs + (*this)[naries_.back()].rhs;
+            assert(op != Operation::Dot || (operands_.size() - offset) % 2 == 0);
+
+            const auto index = push(op, 0, offset, 0, operands_.size() - offset, 0);
+            naries_.push_back(index);
+            evaluate((*this)[index]);
+            return index;
+        }
+
+        /// @brief Records a function of all operands which were added since
+        /// the last n-ary statement and computes its outputs. The outputs are
+        /// recorded as consecutive statements.
+        /// @return index of the statement of the first output
+        Index recordFunction(std::unique_ptr<Function> function, const Index outputs)
+        {
+            const Index offset = naries_.empty() ? 0 : (*this)[naries_.back()].lhs + (*this)[naries_.back()].rhs;
+
+            const auto index = push(Operation::External, 0, offset, 0, operands_.size() - offset, 0);
+            naries_.push_back(index);
+            functions_.push_back({index, outputs, std::move(function)});
+            for(Index k = 0; k < outputs; ++k)
+                push(Operation::Output, 0, index, 0, None, 0);
+            evaluateFunction(index);
+            return index + 1;
+        }
+
+        /// @brief Records the comparison of two statements and returns its
+        /// outcome.
+        bool compare(const Comparison comparison, const Index lhs, const Index rhs)
+        {
+            const bool outcome = compare(comparison, (*this)[lhs].value, (*this)[rhs].value);
+            conditions_.push_back({comparison, outcome, lhs, rhs, size_});
+            return outcome;
+        }
+
+        /// @brief Returns the recorded comparisons.
+        const std::vector<Condition> &conditions() const
+        {
+            return conditions_;
+        }
+
+        /// @brief Recomputes the values and partial derivatives of all
+        /// statements from the current values of the parameters and constants.
+        /// Nothing is recorded or allocated.
+        /// @return true if all recorded comparisons still yield the same
+        /// outcome, false if the function has to be recorded again, since
+        /// its control flow would differ at the new parameter values.
+        bool replay()
+        {
+            for(Index i = 0; i < size_; ++i)
+            {
+                auto &stmt = (*this)[i];
+                if(stmt.op == Operation::External)
+                    evaluateFunction(i);
+                else
+                    evaluate(stmt);
+            }
+            return consistent();
+        }
+
+        /// @brief Checks if all recorded comparisons yield the same outcome
+        /// with the current values of the statements.
+        bool consistent() const
+        {
+            for(const auto &cond : conditions_)
+            {
+                if(compare(cond.comparison, (*this)[cond.lhs].value, (*this)[cond.rhs].value) != cond.outcome)
+                    return false;
+            }
+            return true;
+        }
+
+        /// @brief Shrinks the recorded graph in place and returns the number of
+        /// statements before and after.
+        ///
+        /// A single forward pass folds statements whose operands are all
+        /// constants into constants, replaces Negate(Negate(x)) by x and
+        /// merges structurally identical statements (hash consing). A
+        /// backward pass then drops all statements which neither the given
+        /// outputs, the recorded comparisons nor any function depends on, and
+        /// the remaining statements are compacted. Parameters are always
+        /// kept at their statement index, so the numbers holding them stay
+        /// valid and can be changed before a replay. Statements in front of a
+        /// parameter which are no longer needed are replaced by constants.
+        ///
+        /// The indices in outputs are replaced by the new indices of their
+        /// statements. The statement indices of all other numbers which are
+        /// no parameters are invalid afterwards, which is asserted when they
+        /// are used.
+        Optimization optimize(Index *outputs, const Index count)
+        {
+            Optimization result{size_, 0, 0, 0};
+
+            // forward pass: fold, forward and merge statements
+            std::vector<Index> alias(size_);
+            std::unordered_map<Key, Index, KeyHash> unique;
+            Key key;
+            for(Index i = 0; i < size_; ++i)
+            {
+                alias[i] = i;
+                auto &stmt = (*this)[i];
+                if(stmt.op == Operation::Parameter || stmt.op == Operation::Output)
+                    continue;
+
+                // functions keep their operands in the operand list like
+                // n-ary statements, but are never folded
+                bool constant = stmt.op != Operation::External;
+                if(isNary(stmt.op) || stmt.op == Operation::External)
+                {
+                    Operand *operands = &operands_[stmt.lhs];
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                    {
+                        operands[k].index = alias[operands[k].index];
+                        constant = constant && (*this)[operands[k].index].op == Operation::Constant;
+                    }
+                }
+                else if(stmt.op != Operation::Constant)
+                {
+                    stmt.lhs = alias[stmt.lhs];
+                    constant = (*this)[stmt.lhs].op == Operation::Constant;
+                    if(stmt.rhs != None)
+                    {
+                        stmt.rhs = alias[stmt.rhs];
+                        constant = constant && (*this)[stmt.rhs].op == Operation::Constant;
+                    }
+                }
+
+                if(stmt.op == Operation::External)
+                    continue;
+
+                if(constant && stmt.op != Operation::Constant)
+                {
+                    stmt = {Operation::Constant, None, None, stmt.value, 0, 0};
+                    ++result.folded;
+                }
+                else if(stmt.op == Operation::Negate && (*this)[stmt.lhs].op == Operation::Negate)
+                {
+                    alias[i] = (*this)[stmt.lhs].lhs;
+                    ++result.merged;
+                    continue;
+                }
+
+                makeKey(stmt, key);
+                const auto inserted = unique.insert({key, i});
+                if(!inserted.second)
+                {
+                    alias[i] = inserted.first->second;
+                    ++result.merged;
+                }
+            }
+
+            // backward pass: mark the statements the roots depend on
+            std::vector<char> live(size_, 0);
+            for(Index k = 0; k < count; ++k)
+                live[alias[outputs[k]]] = 1;
+            for(const auto index : parameters_)
+                live[index] = 1;
+            for(auto &cond : conditions_)
+            {
+                cond.lhs = alias[cond.lhs];
+                cond.rhs = alias[cond.rhs];
+                live[cond.lhs] = 1;
+                live[cond.rhs] = 1;
+            }
+
+            for(Index i = size_; i-- > 0;)
+            {
+                if(!live[i])
+                    continue;
+
+                const auto &stmt = (*this)[i];
+                switch(stmt.op)
+                {
+                case Operation::Parameter:
+                case Operation::Constant:
+                    break;
+                case Operation::Sum:
+                case Operation::Dot:
+                case Operation::SquaredNorm:
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        live[operands_[stmt.lhs + k].index] = 1;
+                    break;
+                case Operation::External:
+                    // the outputs directly follow their function
+                    for(Index k = 0; k < function(i).outputs; ++k)
+                        live[i + 1 + k] = 1;
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        live[operands_[stmt.lhs + k].index] = 1;
+                    break;
+                default:
+                    live[stmt.lhs] = 1;
+                    if(stmt.rhs != None)
+                        live[stmt.rhs] = 1;
+                    break;
+                }
+            }
+
+            // compact the live statements and their operands
+            std::vector<Index> position(size_ + 1);
+            std::vector<Operand> operands;
+            std::vector<External> functions;
+            auto func = functions_.begin();
+            naries_.clear();
+            Index size = 0;
+            for(Index i = 0; i < size_; ++i)
+            {
+                while(func != functions_.end() && func->index < i)
+                    ++func;
+                if((*this)[i].op == Operation::Parameter)
+                {
+                    // parameters keep their index, so the numbers holding them
+                    // stay valid; the free statements before them are unused
+                    for(; size < i; ++size)
+                        (*this)[size] = {Operation::Constant, None, None, 0, 0, 0};
+                }
+                position[i] = size;
+                if(!live[i])
+                    continue;
+
+                Statement stmt = (*this)[i];
+                if(isNary(stmt.op) || stmt.op == Operation::External)
+                {
+                    const Index offset = operands.size();
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        operands.push_back({position[operands_[stmt.lhs + k].index], operands_[stmt.lhs + k].weight});
+                    stmt.lhs = offset;
+                    naries_.push_back(size);
+                    if(stmt.op == Operation::External)
+                        functions.push_back({size, func->outputs, std::move(func->function)});
+                }
+                else if(stmt.op != Operation::Parameter && stmt.op != Operation::Constant)
+                {
+                    stmt.lhs = position[stmt.lhs];
+                    if(stmt.rhs != None)
+                        stmt.rhs = position[stmt.rhs];
+                }
+                (*this)[size++] = stmt;
+            }
+            position[size_] = size;
+
+            for(auto &index : parameters_)
+                index = position[index];
+            for(auto &cond : conditions_)
+            {
+                cond.lhs = position[cond.lhs];
+                cond.rhs = position[cond.rhs];
+                cond.position = position[cond.position];
+            }
+            for(Index k = 0; k < count; ++k)
+                outputs[k] = position[alias[outputs[k]]];
+
+            operands_.swap(operands);
+            functions_.swap(functions);
+            size_ = size;
+            while(chunks_.size() > (size_ + ChunkMask) >> ChunkBits)
+            {
+                pool_->release(std::move(chunks_.back()));
+                chunks_.pop_back();
+            }
+
+            ++generation_;
+            result.after = size_;
+            return result;
+        }
+
+        /// @brief Computes the derivatives of the given statement w.r.t. all
+        /// parameters recorded on this tape. The derivatives are stored by
+        /// parameter index.
+        ///
+        /// The statements are visited exactly once in reverse order, which is
+        /// a topological order of the recorded graph. Adjoints are accumulated
+        /// per statement, so shared subexpressions are not traversed again.
+        void derivative(std::vector<Scalar> &derivatives, const Index index)
+        {
+            const Scalar seed = 1;
+            derivative(derivatives, &index, &seed, 1);
+        }
+
+        /// @brief Computes the derivatives of the weighted sum of the given
+        /// output statements w.r.t. all parameters, i.e. the product of the
+        /// transposed Jacobian of the outputs with the given seeds, in a
+        /// single reverse sweep. The derivatives are stored by parameter
+        /// index.
+        void derivative(std::vector<Scalar> &derivatives,
+            const Index *outputs,
+            const Scalar *seeds,
+            const Index count)
+        {
+            Index index = 0;
+            for(Index k = 0; k < count; ++k)
+                index = std::max(index, outputs[k]);
+
+            derivatives.assign(parameters_.size(), Scalar{0});
+            adjointCount_ = 1;
+            adjoints_.assign(count == 0 ? 0 : index + 1, Scalar{0});
+            for(Index k = 0; k < count; ++k)
+                adjoints_[outputs[k]] += seeds[k];
+
+            for(Index i = index + 1; count > 0 && i-- > 0;)
+            {
+                const Scalar weight = adjoints_[i];
+                if(weight == 0)
+                    continue;
+
+                const auto &stmt = (*this)[i];
+                switch(stmt.op)
+                {
+                case Operation::Parameter:
+                    derivatives[stmt.lhs] += weight;
+                    break;
+                case Operation::Constant:
+                    break;
+                case Operation::Abs:
+                    adjoints_[stmt.lhs] += std::abs(weight);
+                    break;
+                case Operation::Sum:
+                case Operation::Dot:
+                case Operation::SquaredNorm:
+                {
+                    const Operand *operands = &operands_[stmt.lhs];
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        adjoints_[operands[k].index] += weight * operands[k].weight;
+                    break;
+                }
+                case Operation::Output:
+                    // only marks the function, which reads the adjoints of
+                    // all its outputs at once
+                    adjoints_[stmt.lhs] = 1;
+                    break;
+                case Operation::External:
+                {
+                    const auto &func = function(i);
+                    // outputs recorded after the seed statement have no adjoint
+                    const Index outputs = std::min(func.outputs, index - i);
+                    scratch_.assign(func.outputs + stmt.rhs, Scalar{0});
+                    std::copy(&adjoints_[i + 1], &adjoints_[i + 1] + outputs, scratch_.begin());
+                    func.function->adjoint(scratch_.data(), scratch_.data() + func.outputs);
+
+                    const Operand *operands = &operands_[stmt.lhs];
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        adjoints_[operands[k].index] += scratch_[func.outputs + k];
+                    break;
+                }
+                default:
+                    adjoints_[stmt.lhs] += weight * stmt.weightLhs;
+                    if(stmt.rhs != None)
+                        adjoints_[stmt.rhs] += weight * stmt.weightRhs;
+                    break;
+                }
+            }
+        }
+
+        /// @brief Computes the adjoints of all statements w.r.t. several
+        /// output statements in a single reverse sweep. Every statement holds
+        /// one adjoint per output, which are propagated together.
+        ///
+        /// Afterwards adjoint() returns the derivative of an output w.r.t. any
+        /// statement, in particular w.r.t. the parameters.
+        void adjoints(const Index *outputs, const Index count)
+        {
+            adjoints(outputs, nullptr, count, count);
+        }
+
+        /// @brief Computes the adjoints of all statements w.r.t. several
+        /// output statements in a single reverse sweep, where output k is
+        /// seeded in direction directions[k]. Outputs which share a direction
+        /// are propagated together, which compresses the sweep if they do not
+        /// depend on common parameters. A null directions pointer seeds every
+        /// output in its own direction.
+        void adjoints(const Index *outputs, const Index *directions, const Index outputCount, const Index count)
+        {
+            Index last = 0;
+            for(Index k = 0; k < outputCount; ++k)
+                last = std::max(last, outputs[k]);
+
+            adjointCount_ = count;
+            adjoints_.assign(outputCount == 0 ? 0 : (last + 1) * count, Scalar{0});
+            for(Index k = 0; k < outputCount; ++k)
+                adjoints_[outputs[k] * count + (directions != nullptr ? directions[k] : k)] = 1;
+
+            for(Index i = last + 1; outputCount > 0 && count > 0 && i-- > 0;)
+            {
+                const Scalar *weights = &adjoints_[i * count];
+                if(std::all_of(weights, weights + count, [](const Scalar w) { return w == 0; }))
+                    continue;
+
+                const auto &stmt = (*this)[i];
+                switch(stmt.op)
+                {
+                case Operation::Parameter:
+                case Operation::Constant:
+                    break;
+                case Operation::Abs:
+                {
+                    Scalar *lhs = &adjoints_[stmt.lhs * count];
+                    for(Index k = 0; k < count; ++k)
+                        lhs[k] += std::abs(weights[k]);
+                    break;
+                }
+                case Operation::Sum:
+                case Operation::Dot:
+                case Operation::SquaredNorm:
+                {
+                    const Operand *operands = &operands_[stmt.lhs];
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        internal::axpy(count, operands[k].weight, weights, &adjoints_[operands[k].index * count]);
+                    break;
+                }
+                case Operation::Output:
+                    adjoints_[stmt.lhs * count] = 1;
+                    break;
+                case Operation::External:
+                {
+                    const auto &func = function(i);
+                    const Index outputs = std::min(func.outputs, last - i);
+                    const Operand *operands = &operands_[stmt.lhs];
+                    for(Index l = 0; l < count; ++l)
+                    {
+                        scratch_.assign(func.outputs + stmt.rhs, Scalar{0});
+                        for(Index k = 0; k < outputs; ++k)
+                            scratch_[k] = adjoints_[(i + 1 + k) * count + l];
+                        func.function->adjoint(scratch_.data(), scratch_.data() + func.outputs);
+
+                        for(Index k = 0; k < stmt.rhs; ++k)
+                            adjoints_[operands[k].index * count + l] += scratch_[func.outputs + k];
+                    }
+                    break;
+                }
+                default:
+                    internal::axpy(count, stmt.weightLhs, weights, &adjoints_[stmt.lhs * count]);
+                    if(stmt.rhs != None)
+                        internal::axpy(count, stmt.weightRhs, weights, &adjoints_[stmt.rhs * count]);
+                    break;
+                }
+            }
+        }
+
+        /// @brief Computes the gradient of the given statement w.r.t. all
+        /// parameters and the product of its Hessian with the given direction,
+        /// both stored by parameter index.
+        ///
+        /// The tangents of all statements in the given direction are
+        /// propagated forward first. Then the reverse sweep is differentiated
+        /// in this direction (forward over reverse), which propagates the
+        /// tangents of the adjoints along with the adjoints. The cost is
+        /// about that of two gradients. Functions the statement depends on
+        /// have to implement Function::tangent() and Function::curvature(),
+        /// otherwise std::logic_error is thrown.
+        void hessianVectorProduct(const Index index,
+            const std::vector<Scalar> &direction,
+            std::vector<Scalar> &gradient,
+            std::vector<Scalar> &product)
+        {
+            assert(direction.size() == parameters_.size());
+
+            // outputs of functions without tangents are marked, the reverse
+            // sweep only rejects them if they are reached
+            std::vector<char> unavailable(index + 1, 0);
+            tangents_.assign(index + 1, Scalar{0});
+            for(Index i = 0; i <= index; ++i)
+            {
+                const auto &stmt = (*this)[i];
+                switch(stmt.op)
+                {
+                case Operation::Parameter:
+                    tangents_[i] = direction[stmt.lhs];
+                    break;
+                case Operation::Constant:
+                case Operation::Output:
+                    break;
+                case Operation::External:
+                {
+                    const auto &func = function(i);
+                    std::vector<Scalar> inputs(stmt.rhs);
+                    std::vector<Scalar> outputs(func.outputs, Scalar{0});
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        inputs[k] = tangents_[operands_[stmt.lhs + k].index];
+                    const bool available = func.function->tangent(inputs.data(), outputs.data());
+                    for(Index k = 0; k < func.outputs && i + 1 + k <= index; ++k)
+                    {
+                        tangents_[i + 1 + k] = available ? outputs[k] : std::numeric_limits<Scalar>::quiet_NaN();
+                        unavailable[i + 1 + k] = !available;
+                    }
+                    break;
+                }
+                case Operation::Abs:
+                    tangents_[i] = (*this)[stmt.lhs].value < 0 ? -tangents_[stmt.lhs] : tangents_[stmt.lhs];
+                    break;
+                case Operation::Sum:
+                case Operation::Dot:
+                case Operation::SquaredNorm:
+                {
+                    const Operand *operands = &operands_[stmt.lhs];
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        tangents_[i] += operands[k].weight * tangents_[operands[k].index];
+                    break;
+                }
+                default:
+                    tangents_[i] = stmt.weightLhs * tangents_[stmt.lhs];
+                    if(stmt.rhs != None)
+                        tangents_[i] += stmt.weightRhs * tangents_[stmt.rhs];
+                    break;
+                }
+            }
+
+            gradient.assign(parameters_.size(), Scalar{0});
+            product.assign(parameters_.size(), Scalar{0});
+            adjointCount_ = 1;
+            adjoints_.assign(index + 1, Scalar{0});
+            adjoints_[index] = 1;
+            tangentAdjoints_.assign(index + 1, Scalar{0});
+
+            for(Index i = index + 1; i-- > 0;)
+            {
+                const Scalar weight = adjoints_[i];
+                const Scalar tangentWeight = tangentAdjoints_[i];
+                if(weight == 0 && tangentWeight == 0)
+                    continue;
+
+                const auto &stmt = (*this)[i];
+                switch(stmt.op)
+                {
+                case Operation::Parameter:
+                    gradient[stmt.lhs] += weight;
+                    product[stmt.lhs] += tangentWeight;
+                    break;
+                case Operation::Constant:
+                    break;
+                case Operation::Abs:
+                    adjoints_[stmt.lhs] += std::abs(weight);
+                    tangentAdjoints_[stmt.lhs] += weight < 0 ? -tangentWeight : tangentWeight;
+                    break;
+                case Operation::Output:
+                    // only marks the function, which reads the adjoints of
+                    // all its outputs at once
+                    adjoints_[stmt.lhs] = 1;
+                    break;
+                case Operation::External:
+                {
+                    const auto &func = function(i);
+                    const Index outputs = std::min(func.outputs, index - i);
+                    if(outputs > 0 && unavailable[i + 1])
+                        throw std::logic_error("second order derivatives of functions are not supported");
+
+                    std::vector<Scalar> weights(func.outputs, Scalar{0});
+                    std::vector<Scalar> tangentWeights(func.outputs, Scalar{0});
+                    std::copy(&adjoints_[i + 1], &adjoints_[i + 1] + outputs, weights.begin());
+                    std::copy(&tangentAdjoints_[i + 1], &tangentAdjoints_[i + 1] + outputs, tangentWeights.begin());
+
+                    const Operand *operands = &operands_[stmt.lhs];
+                    std::vector<Scalar> inputs(stmt.rhs);
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        inputs[k] = tangents_[operands[k].index];
+                    std::vector<Scalar> adjoints(stmt.rhs, Scalar{0});
+                    std::vector<Scalar> tangentAdjoints(stmt.rhs, Scalar{0});
+                    func.function->adjoint(weights.data(), adjoints.data());
+                    func.function->adjoint(tangentWeights.data(), tangentAdjoints.data());
+                    func.function->curvature(weights.data(), inputs.data(), tangentAdjoints.data());
+
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                    {
+                        adjoints_[operands[k].index] += adjoints[k];
+                        tangentAdjoints_[operands[k].index] += tangentAdjoints[k];
+                    }
+                    break;
+                }
+                case Operation::Sum:
+                case Operation::Dot:
+                case Operation::SquaredNorm:
+                {
+                    const Operand *operands = &operands_[stmt.lhs];
+                    const Index count = stmt.op == Operation::Dot ? stmt.rhs / 2 : stmt.rhs;
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                    {
+                        // tangent of the partial derivative of this operand
+                        Scalar tangent = 0;
+                        if(stmt.op == Operation::Dot)
+                            tangent = tangents_[operands[k < count ? k + count : k - count].index];
+                        else if(stmt.op == Operation::SquaredNorm)
+                            tangent = 2 * tangents_[operands[k].index];
+
+                        adjoints_[operands[k].index] += weight * operands[k].weight;
+                        tangentAdjoints_[operands[k].index] += tangentWeight * operands[k].weight + weight * tangent;
+                    }
+                    break;
+                }
+                default:
+                {
+                    Scalar tangentLhs = 0;
+                    Scalar tangentRhs = 0;
+                    tangentWeights(stmt, tangents_[stmt.lhs], stmt.rhs != None ? tangents_[stmt.rhs] : Scalar{0},
+                        tangentLhs, tangentRhs);
+
+                    adjoints_[stmt.lhs] += weight * stmt.weightLhs;
+                    tangentAdjoints_[stmt.lhs] += tangentWeight * stmt.weightLhs + weight * tangentLhs;
+                    if(stmt.rhs != None)
+                    {
+                        adjoints_[stmt.rhs] += weight * stmt.weightRhs;
+                        tangentAdjoints_[stmt.rhs] += tangentWeight * stmt.weightRhs + weight * tangentRhs;
+                    }
+                    break;
+                }
+                }
+            }
+        }
+
+        /// @brief Computes the gradient of the given statement w.r.t. all
+        /// parameters and the lower triangle of its Hessian as sorted entries
+        /// with row >= col, both by parameter index.
+        ///
+        /// Implements edge pushing: a single reverse sweep carries the
+        /// nonzero second order adjoints between pairs of statements along
+        /// with the adjoints. Whenever a statement is processed, its second
+        /// order adjoints are pushed onto its operands and the curvature of
+        /// the statement itself is created between its operands. Only
+        /// structurally nonzero entries are ever touched, so sparse Hessians
+        /// come at a fraction of the cost of one Hessian-vector product per
+        /// parameter. Functions the statement depends on have to implement
+        /// Function::curvature(), otherwise std::logic_error is thrown.
+        void hessian(const Index index, std::vector<Scalar> &gradient, std::vector<HessianEntry> &entries)
+        {
+            gradient.assign(parameters_.size(), Scalar{0});
+            entries.clear();
+            adjointCount_ = 1;
+            adjoints_.assign(index + 1, Scalar{0});
+            adjoints_[index] = 1;
+            if(secondAdjoints_.size() < index + 1)
+                secondAdjoints_.resize(index + 1);
+            for(Index i = 0; i <= index; ++i)
+                secondAdjoints_[i].clear();
+
+            std::vector<Operand> operands;
+            std::vector<HessianEntry> curvature;
+            for(Index i = index + 1; i-- > 0;)
+            {
+                const auto &stmt = (*this)[i];
+                const Scalar weight = adjoints_[i];
+                if(stmt.op == Operation::Parameter)
+                {
+                    gradient[stmt.lhs] += weight;
+                    continue;
+                }
+                // outputs are processed along with their function
+                if(stmt.op == Operation::Constant || stmt.op == Operation::Output)
+                    continue;
+                if(stmt.op == Operation::External)
+                {
+                    pushFunction(i, index, entries);
+                    continue;
+                }
+
+                auto &row = secondAdjoints_[i];
+                if(weight == 0 && row.empty())
+                    continue;
+
+                secondPartials(stmt, weight, operands, curvature);
+
+                // merge the second order adjoints of this statement
+                std::sort(row.begin(), row.end(),
+                    [](const std::pair<Index, Scalar> &lhs, const std::pair<Index, Scalar> &rhs)
+                    { return lhs.first < rhs.first; });
+                Scalar diagonal = 0;
+                for(std::size_t k = 0; k < row.size();)
+                {
+                    const Index neighbor = row[k].first;
+                    Scalar value = 0;
+                    for(; k < row.size() && row[k].first == neighbor; ++k)
+                        value += row[k].second;
+
+                    if(neighbor == i)
+                    {
+                        diagonal = value;
+                        continue;
+                    }
+                    for(const auto &operand : operands)
+                    {
+                        if(operand.index == neighbor)
+                            pushSecondAdjoint(neighbor, neighbor, 2 * value * operand.weight, entries);
+                        else
+                            pushSecondAdjoint(neighbor, operand.index, value * operand.weight, entries);
+                    }
+                }
+                row.clear();
+
+                if(diagonal != 0)
+                {
+                    for(std::size_t a = 0; a < operands.size(); ++a)
+                    {
+                        for(std::size_t b = a; b < operands.size(); ++b)
+                            pushCurvature(operands, a, b, diagonal * operands[a].weight * operands[b].weight, entries);
+                    }
+                }
+                for(const auto &entry : curvature)
+                    pushCurvature(operands, entry.row, entry.col, weight * entry.value, entries);
+
+                for(const auto &operand : operands)
+                    adjoints_[operand.index] += weight * operand.weight;
+            }
+
+            // combine the contributions to the same entry
+            std::sort(entries.begin(), entries.end(),
+                [](const HessianEntry &lhs, const HessianEntry &rhs)
+                { return lhs.row < rhs.row || (lhs.row == rhs.row && lhs.col < rhs.col); });
+            std::size_t count = 0;
+            for(std::size_t k = 0; k < entries.size(); ++k)
+            {
+                if(count > 0 && entries[count - 1].row == entries[k].row && entries[count - 1].col == entries[k].col)
+                    entries[count - 1].value += entries[k].value;
+                else
+                    entries[count++] = entries[k];
+            }
+            entries.resize(count);
+        }
+
+        /// @brief Determines the parameters which the given output statements
+        /// depend on, regardless of the recorded values. Afterwards pattern[k]
+        /// holds the sorted indices of the parameters of output k.
+        ///
+        /// The parameter sets are propagated forward through all statements
+        /// up to the last output. Functions are assumed to make every output
+        /// depend on all inputs.
+        void sparsity(const Index *outputs, const Index count, std::vector<std::vector<Index>> &pattern) const
+        {
+            Index last = 0;
+            for(Index k = 0; k < count; ++k)
+                last = std::max(last, outputs[k]);
+
+            std::vector<std::vector<Index>> sets(count == 0 ? 0 : last + 1);
+            std::vector<Index> merged;
+            for(Index i = 0; i < sets.size(); ++i)
+            {
+                const auto &stmt = (*this)[i];
+                auto &set = sets[i];
+                switch(stmt.op)
+                {
+                case Operation::Parameter:
+                    set.push_back(stmt.lhs);
+                    break;
+                case Operation::Constant:
+                    break;
+                case Operation::Sum:
+                case Operation::Dot:
+                case Operation::SquaredNorm:
+                case Operation::External:
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        unite(set, sets[operands_[stmt.lhs + k].index], merged);
+                    break;
+                case Operation::Output:
+                    set = sets[stmt.lhs];
+                    break;
+                default:
+                    set = sets[stmt.lhs];
+                    if(stmt.rhs != None)
+                        unite(set, sets[stmt.rhs], merged);
+                    break;
+                }
+            }
+
+            pattern.resize(count);
+            for(Index k = 0; k < count; ++k)
+                pattern[k] = sets[outputs[k]];
+        }
+
+        /// @brief Returns the derivative of the given output w.r.t. the given
+        /// statement as computed by the last call of adjoints().
+        Scalar adjoint(const Index index, const Index output) const
+        {
+            assert(output < adjointCount_);
+            const Index position = index * adjointCount_ + output;
+            return position < adjoints_.size() ? adjoints_[position] : Scalar{0};
+        }
+
+        /// @brief Registers a number which refers to this tape.
+        void acquire()
+        {
+#if defined(ADCPP_THREAD_SAFE)
+            references_.fetch_add(1, std::memory_order_relaxed);
+#else
+            ++references_;
+#endif
+        }
+
+        /// @brief Unregisters a number which refers to this tape. The tape is
+        /// reset once no more numbers refer to it.
+        void release()
+        {
+#if defined(ADCPP_THREAD_SAFE)
+            const Index references = references_.fetch_sub(1, std::memory_order_acq_rel);
+            assert(references > 0);
+            if(references == 1)
+                reset();
+#else
+            assert(references_ > 0);
+            --references_;
+            if(references_ == 0)
+                reset();
+#endif
+        }
+
+    private:
+        struct External
+        {
+            /// Index of the External statement.
+            Index index;
+            Index outputs;
+            std::unique_ptr<Function> function;
+        };
+
+        static constexpr Index ChunkBits = 12;
+        static constexpr Index ChunkSize = Index{1} << ChunkBits;
+        static constexpr Index ChunkMask = ChunkSize - 1;
+
+        std::shared_ptr<Pool> pool_;
+        std::vector<Chunk> chunks_;
+        std::vector<Scalar> adjoints_;
+        std::vector<Index> parameters_;
+        std::vector<Condition> conditions_;
+        std::vector<Operand> operands_;
+        std::vector<Index> naries_;
+        std::vector<External> functions_;
+        std::vector<Scalar> scratch_;
+        std::vector<Scalar> tangents_;
+        std::vector<Scalar> tangentAdjoints_;
+        std::vector<std::vector<std::pair<Index, Scalar>>> secondAdjoints_;
+        Index adjointCount_ = 0;
+        Index size_ = 0;
+        Index generation_ = 0;
+#if defined(ADCPP_THREAD_SAFE)
+        std::atomic<Index> references_{0};
+#else
+        Index references_ = 0;
+#endif
+
+        /// @brief Structure of a statement which identifies it up to the
+        /// values of its operands.
+        struct Key
+        {
+            Operation op;
+            Index lhs;
+            Index rhs;
+            Scalar argument;
+            std::vector<Index> operands;
+
+            bool operator==(const Key &other) const
+            {
+                // arguments are compared bitwise, so 0 and -0 stay apart
+                return op == other.op && lhs == other.lhs && rhs == other.rhs
+                    && std::memcmp(&argument, &other.argument, sizeof(Scalar)) == 0
+                    && operands == other.operands;
+            }
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const Key &key) const
+            {
+                std::size_t hash = static_cast<std::size_t>(key.op);
+                const auto combine = [&hash](const std::size_t value)
+                {
+                    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+                };
+                combine(key.lhs);
+                combine(key.rhs);
+                const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&key.argument);
+                for(std::size_t k = 0; k < sizeof(Scalar); ++k)
+                    combine(bytes[k]);
+                for(const auto index : key.operands)
+                    combine(index);
+                return hash;
+            }
+        };
+
+        static bool isNary(const Operation op)
+        {
+            return op == Operation::Sum || op == Operation::Dot || op == Operation::SquaredNorm;
+        }
+
+        /// @brief Computes the key of the given statement, whose operands must
+        /// not be recorded functions.
+        void makeKey(const Statement &stmt, Key &key) const
+        {
+            key.op = stmt.op;
+            key.lhs = None;
+            key.rhs = None;
+            key.argument = 0;
+            key.operands.clear();
+
+            if(stmt.op == Operation::Constant)
+            {
+                key.argument = stmt.value;
+            }
+            else if(isNary(stmt.op))
+            {
+                for(Index k = 0; k < stmt.rhs; ++k)
+                    key.operands.push_back(operands_[stmt.lhs + k].index);
+            }
+            else if(stmt.rhs == None)
+            {
+                // unary operations keep their scalar argument in weightRhs
+                key.lhs = stmt.lhs;
+                key.argument = stmt.weightRhs;
+            }
+            else
+            {
+                const bool commutative = stmt.op == Operation::Add || stmt.op == Operation::Multiply;
+                key.lhs = commutative ? std::min(stmt.lhs, stmt.rhs) : stmt.lhs;
+                key.rhs = commutative ? std::max(stmt.lhs, stmt.rhs) : stmt.rhs;
+            }
+        }
+
+        /// @brief Returns the tape selected by the innermost ActiveScope of
+        /// the calling thread or nullptr.
+        static Tape<Scalar> *&current()
+        {
+            static thread_local Tape<Scalar> *tape = nullptr;
+            return tape;
+        }
+
+        /// @brief Returns the function recorded by the given External statement.
+        const External &function(const Index index) const
+        {
+            const auto it = std::lower_bound(functions_.begin(), functions_.end(), index,
+                [](const External &func, const Index idx) { return func.index < idx; });
+            assert(it != functions_.end() && it->index == index);
+            return *it;
+        }
+
+        void releaseChunks()
+        {
+            for(auto &chunk : chunks_)
+                pool_->release(std::move(chunk));
+            chunks_.clear();
+        }
+
+        /// @brief Merges the sorted set rhs into the sorted set lhs.
+        static void unite(std::vector<Index> &lhs, const std::vector<Index> &rhs, std::vector<Index> &merged)
+        {
+            if(rhs.empty())
+                return;
+            merged.clear();
+            std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(merged));
+            lhs.swap(merged);
+        }
+
+        static bool compare(const Comparison comparison, const Scalar lhs, const Scalar rhs)
+        {
+            switch(comparison)
+            {
+            case Comparison::Equal:
+                return lhs == rhs;
+            case Comparison::NotEqual:
+                return lhs != rhs;
+            case Comparison::Less:
+                return lhs < rhs;
+            case Comparison::LessEqual:
+                return lhs <= rhs;
+            case Comparison::Greater:
+                return lhs > rhs;
+            case Comparison::GreaterEqual:
+                return lhs >= rhs;
+            }
+            return false;
+        }
+
+        void evaluateNary(Statement &stmt)
+        {
+            Operand *operands = &operands_[stmt.lhs];
+            const Index count = stmt.rhs;
+            Scalar value = 0;
+
+            switch(stmt.op)
+            {
+            case Operation::Sum:
+                for(Index k = 0; k < count; ++k)
+                {
+                    value += (*this)[operands[k].index].value;
+                    operands[k].weight = 1;
+                }
+                break;
+            case Operation::Dot:
+                for(Index k = 0; k < count / 2; ++k)
+                {
+                    const Scalar a = (*this)[operands[k].index].value;
+                    const Scalar b = (*this)[operands[k + count / 2].index].value;
+                    value += a * b;
+                    operands[k].weight = b;
+                    operands[k + count / 2].weight = a;
+                }
+                break;
+            case Operation::SquaredNorm:
+                for(Index k = 0; k < count; ++k)
+                {
+                    const Scalar a = (*this)[operands[k].index].value;
+                    value += a * a;
+                    operands[k].weight = 2 * a;
+                }
+                break;
+            default:
+                assert(false);
+                break;
+            }
+
+            stmt.value = value;
+        }
+
+        /// @brief Computes the values of the outputs of the given External
+        /// statement.
+        void evaluateFunction(const Index index)
+        {
+            const auto &stmt = (*this)[index];
+            const auto &func = function(index);
+            const Operand *operands = &operands_[stmt.lhs];
+
+            scratch_.resize(stmt.rhs + func.outputs);
+            for(Index k = 0; k < stmt.rhs; ++k)
+                scratch_[k] = (*this)[operands[k].index].value;
+            func.function->evaluate(scratch_.data(), scratch_.data() + stmt.rhs);
+            for(Index k = 0; k < func.outputs; ++k)
+                (*this)[index + 1 + k].value = scratch_[stmt.rhs + k];
+        }
+
+        /// @brief Computes the tangents of the partial derivatives of the given
+        /// unary or binary statement from the tangents of its operands.
+        /// Unit tangents yield its second order partial derivatives.
+        void tangentWeights(const Statement &stmt,
+            const Scalar tx,
+            const Scalar ty,
+            Scalar &tangentLhs,
+            Scalar &tangentRhs) const
+        {
+            const Scalar x = (*this)[stmt.lhs].value;
+            const Scalar y = stmt.rhs != None ? (*this)[stmt.rhs].value : Scalar{0};
+
+            switch(stmt.op)
+            {
+            case Operation::Multiply:
+                tangentLhs = ty;
+                tangentRhs = tx;
+                break;
+            case Operation::Divide:
+                tangentLhs = -ty / (y * y);
+                tangentRhs = (-tx + 2 * x * ty / y) / (y * y);
+                break;
+            case Operation::ScalarDivide:
+                tangentLhs = 2 * stmt.weightRhs * tx / (x * x * x);
+                break;
+            case Operation::Sin:
+                tangentLhs = -stmt.value * tx;
+                break;
+            case Operation::Cos:
+                tangentLhs = -stmt.value * tx;
+                break;
+            case Operation::ArcSin:
+            case Operation::ArcCos:
+                tangentLhs = x * stmt.weightLhs * stmt.weightLhs * stmt.weightLhs * tx;
+                break;
+            case Operation::Tan:
+                tangentLhs = 2 * stmt.value * stmt.weightLhs * tx;
+                break;
+            case Operation::ArcTan:
+                tangentLhs = -2 * x * stmt.weightLhs * stmt.weightLhs * tx;
+                break;
+            case Operation::ArcTan2:
+            {
+                // differentiates the recorded partial derivatives
+                const Scalar denom = x * x + y * y;
+                const Scalar tangentDenom = 2 * (x * tx + y * ty);
+                tangentLhs = (ty - stmt.weightLhs * tangentDenom) / denom;
+                tangentRhs = (tx - stmt.weightRhs * tangentDenom) / denom;
+                break;
+            }
+            case Operation::Exp:
+                tangentLhs = stmt.value * tx;
+                break;
+            case Operation::Sqrt:
+                tangentLhs = -stmt.weightLhs * tx / (2 * x);
+                break;
+            case Operation::Abs2:
+                tangentLhs = 2 * tx;
+                break;
+            case Operation::Log:
+            case Operation::Log2:
+                tangentLhs = -stmt.weightLhs * tx / x;
+                break;
+            case Operation::Pow:
+            {
+                const Scalar exponent = stmt.weightRhs;
+                tangentLhs = exponent * (exponent - 1) * std::pow(x, exponent - 2) * tx;
+                break;
+            }
+            case Operation::PowInt:
+            {
+                const int exponent = static_cast<int>(stmt.weightRhs);
+                tangentLhs = exponent * (exponent - 1) * std::pow(x, exponent - 2) * tx;
+                break;
+            }
+            default:
+                // partial derivatives are constant
+                break;
+            }
+        }
+
+        /// @brief Collects the operands of the given statement with their
+        /// partial derivatives and its nonzero second order partial
+        /// derivatives as entries between operand positions with row <= col.
+        void secondPartials(const Statement &stmt,
+            const Scalar weight,
+            std::vector<Operand> &operands,
+            std::vector<HessianEntry> &curvature) const
+        {
+            operands.clear();
+            curvature.clear();
+
+            switch(stmt.op)
+            {
+            case Operation::Abs:
+                // the adjoint is propagated as its absolute value
+                operands.push_back({stmt.lhs, weight < 0 ? Scalar{-1} : Scalar{1}});
+                break;
+            case Operation::Sum:
+            case Operation::Dot:
+            case Operation::SquaredNorm:
+            {
+                const Operand *nary = &operands_[stmt.lhs];
+                operands.assign(nary, nary + stmt.rhs);
+                if(stmt.op == Operation::Dot)
+                {
+                    for(Index k = 0; k < stmt.rhs / 2; ++k)
+                        curvature.push_back({k, k + stmt.rhs / 2, Scalar{1}});
+                }
+                else if(stmt.op == Operation::SquaredNorm)
+                {
+                    for(Index k = 0; k < stmt.rhs; ++k)
+                        curvature.push_back({k, k, Scalar{2}});
+                }
+                break;
+            }
+            default:
+            {
+                Scalar partialLhs = 0;
+                Scalar partialRhs = 0;
+                operands.push_back({stmt.lhs, stmt.weightLhs});
+                tangentWeights(stmt, 1, 0, partialLhs, partialRhs);
+                if(partialLhs != 0)
+                    curvature.push_back({0, 0, partialLhs});
+                if(stmt.rhs != None)
+                {
+                    operands.push_back({stmt.rhs, stmt.weightRhs});
+                    tangentWeights(stmt, 0, 1, partialLhs, partialRhs);
+                    if(partialLhs != 0)
+                        curvature.push_back({0, 1, partialLhs});
+                    if(partialRhs != 0)
+                        curvature.push_back({1, 1, partialRhs});
+                }
+                break;
+            }
+            }
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Processes a function and its outputs in the edge pushing
+        /// sweep of hessian(). Its Jacobian is assembled from one adjoint()
+        /// call per output, its own curvature from one curvature() call per
+        /// input which is no constant.
+        void pushFunction(const Index index, const Index last, std::vector<HessianEntry> &entries)
         {
-            this->expr_->derivative(map, weight * weight_);
-        }
-    };
+            const auto &stmt = (*this)[index];
+            const auto &func = function(index);
+            // outputs recorded after the last statement have no adjoints
+            const Index outputs = std::min(func.outputs, last - index);
+            const Index inputs = stmt.rhs;
+            const Index first = index + 1;
+
+            bool reached = false;
+            for(Index o = 0; o < outputs; ++o)
+                reached = reached || adjoints_[first + o] != 0 || !secondAdjoints_[first + o].empty();
+            if(!reached)
+                return;
+
+            const std::vector<Operand> operands(&operands_[stmt.lhs], &operands_[stmt.lhs] + inputs);
+            std::vector<Scalar> jacobian(outputs * inputs);
+            scratch_.resize(func.outputs + inputs);
+            for(Index o = 0; o < outputs; ++o)
+            {
+                std::fill(scratch_.begin(), scratch_.end(), Scalar{0});
+                scratch_[o] = 1;
+                func.function->adjoint(scratch_.data(), scratch_.data() + func.outputs);
+                std::copy(scratch_.begin() + func.outputs, scratch_.end(), jacobian.begin() + o * inputs);
+            }
 
-    template<typename Scalar>
-    class Pow : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        Pow(const std::shared_ptr<Expression<Scalar>> &expr,
-            const Scalar exponent)
-            : UnaryExpression<Scalar>(std::pow(expr->value(), exponent), expr),
-            weight_(exponent * std::pow(expr->value(), exponent - 1))
-        { }
+            // second order adjoints between two outputs are collected in a
+            // dense matrix, the others are pushed onto the inputs
+            std::vector<Scalar> outer(outputs * outputs, Scalar{0});
+            bool pairs = false;
+            for(Index o = 0; o < outputs; ++o)
+            {
+                auto &row = secondAdjoints_[first + o];
+                for(const auto &entry : row)
+                {
+                    if(entry.first >= first && entry.first < first + outputs)
+                    {
+                        const Index p = entry.first - first;
+                        outer[o * outputs + p] += entry.second;
+                        if(p != o)
+                            outer[p * outputs + o] += entry.second;
+                        pairs = true;
+                        continue;
+                    }
+
+                    for(Index a = 0; a < inputs; ++a)
+                    {
+                        const Scalar partial = jacobian[o * inputs + a];
+                        if(operands[a].index == entry.first)
+                            pushSecondAdjoint(entry.first, entry.first, 2 * entry.second * partial, entries);
+                        else
+                            pushSecondAdjoint(entry.first, operands[a].index, entry.second * partial, entries);
+                    }
+                }
+                row.clear();
+            }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
-        {
-            this->expr_->derivative(map, weight * weight_);
-        }
-    };
+            if(pairs)
+            {
+                // transpose(J) * outer * J
+                std::vector<Scalar> product(outputs * inputs, Scalar{0});
+                for(Index o = 0; o < outputs; ++o)
+                {
+                    for(Index p = 0; p < outputs; ++p)
+                    {
+                        const Scalar value = outer[o * outputs + p];
+                        if(value == 0)
+                            continue;
+                        for(Index b = 0; b < inputs; ++b)
+                            product[o * inputs + b] += value * jacobian[p * inputs + b];
+                    }
+                }
+                for(Index a = 0; a < inputs; ++a)
+                {
+                    for(Index b = a; b < inputs; ++b)
+                    {
+                        Scalar value = 0;
+                        for(Index o = 0; o < outputs; ++o)
+                            value += jacobian[o * inputs + a] * product[o * inputs + b];
+                        pushCurvature(operands, a, b, value, entries);
+                    }
+                }
+            }
 
-    template<typename Scalar>
-    class PowInt : public UnaryExpression<Scalar>
-    {
-    private:
-        Scalar weight_;
-    public:
-        PowInt(const std::shared_ptr<Expression<Scalar>> &expr,
-            const int exponent)
-            : UnaryExpression<Scalar>(std::pow(expr->value(), exponent), expr),
-            weight_(exponent * std::pow(expr->value(), exponent - 1))
-        { }
+            std::vector<Scalar> weights(func.outputs, Scalar{0});
+            std::copy(&adjoints_[first], &adjoints_[first] + outputs, weights.begin());
+            if(std::any_of(weights.begin(), weights.end(), [](const Scalar w) { return w != 0; }))
+            {
+                std::vector<Scalar> tangents(inputs, Scalar{0});
+                std::vector<Scalar> column(inputs);
+                for(Index b = 0; b < inputs; ++b)
+                {
+                    if((*this)[operands[b].index].op == Operation::Constant)
+                        continue;
+
+                    tangents[b] = 1;
+                    std::fill(column.begin(), column.end(), Scalar{0});
+                    func.function->curvature(weights.data(), tangents.data(), column.data());
+                    tangents[b] = 0;
+                    for(Index a = 0; a <= b; ++a)
+                        pushCurvature(operands, a, b, column[a], entries);
+                }
+
+                for(Index a = 0; a < inputs; ++a)
+                {
+                    Scalar adjoint = 0;
+                    for(Index o = 0; o < outputs; ++o)
+                        adjoint += weights[o] * jacobian[o * inputs + a];
+                    adjoints_[operands[a].index] += adjoint;
+                }
+            }
+        }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Adds a contribution to the second order adjoint between the
+        /// operands at the given positions, where a <= b.
+        void pushCurvature(const std::vector<Operand> &operands,
+            const std::size_t a,
+            const std::size_t b,
+            const Scalar value,
+            std::vector<HessianEntry> &entries)
         {
-            this->expr_->derivative(map, weight * weight_);
+            const Index lhs = operands[a].index;
+            const Index rhs = operands[b].index;
+            // both off-diagonal halves land on the same statement
+            if(a != b && lhs == rhs)
+                pushSecondAdjoint(lhs, rhs, 2 * value, entries);
+            else
+                pushSecondAdjoint(lhs, rhs, value, entries);
         }
-    };
-
-    template<typename Scalar>
-    class Add : public BinaryExpression<Scalar>
-    {
-    public:
-        Add(const std::shared_ptr<Expression<Scalar>> &lhs,
-            const std::shared_ptr<Expression<Scalar>> &rhs)
-            : BinaryExpression<Scalar>(lhs->value() + rhs->value(), lhs, rhs)
-        { }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Adds a contribution to the second order adjoint between the
+        /// given statements. Pairs of parameters are final Hessian entries.
+        /// Any other pair is stored with the intermediate statement which is
+        /// processed first by the reverse sweep.
+        void pushSecondAdjoint(const Index lhs,
+            const Index rhs,
+            const Scalar value,
+            std::vector<HessianEntry> &entries)
         {
-            this->lhs_->derivative(map, weight);
-            this->rhs_->derivative(map, weight);
+            if(value == 0)
+                return;
+
+            const auto &stmtLhs = (*this)[lhs];
+            const auto &stmtRhs = (*this)[rhs];
+            if(stmtLhs.op == Operation::Constant || stmtRhs.op == Operation::Constant)
+                return;
+
+            const bool parameterLhs = stmtLhs.op == Operation::Parameter;
+            const bool parameterRhs = stmtRhs.op == Operation::Parameter;
+            if(parameterLhs && parameterRhs)
+                entries.push_back({std::max(stmtLhs.lhs, stmtRhs.lhs), std::min(stmtLhs.lhs, stmtRhs.lhs), value});
+            else if(parameterLhs || (!parameterRhs && rhs > lhs))
+                secondAdjoints_[rhs].push_back({lhs, value});
+            else
+                secondAdjoints_[lhs].push_back({rhs, value});
         }
-    };
-
-    template<typename Scalar>
-    class Subtract : public BinaryExpression<Scalar>
-    {
-    public:
-        Subtract(const std::shared_ptr<Expression<Scalar>> &lhs,
-            const std::shared_ptr<Expression<Scalar>> &rhs)
-            : BinaryExpression<Scalar>(lhs->value() - rhs->value(), lhs, rhs)
-        { }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        /// @brief Computes the value and the partial derivatives of the given
+        /// statement from the values of its operands.
+        void evaluate(Statement &stmt)
         {
-            this->lhs_->derivative(map, weight);
-            this->rhs_->derivative(map, -weight);
-        }
-    };
+            if(stmt.op == Operation::Sum || stmt.op == Operation::Dot || stmt.op == Operation::SquaredNorm)
+            {
+                evaluateNary(stmt);
+                return;
+            }
 
-    template<typename Scalar>
-    class Multiply : public BinaryExpression<Scalar>
-    {
-    public:
-        Multiply(const std::shared_ptr<Expression<Scalar>> &lhs,
-            const std::shared_ptr<Expression<Scalar>> &rhs)
-            : BinaryExpression<Scalar>(lhs->value() * rhs->value(), lhs, rhs)
-        { }
+            const Scalar x = stmt.lhs != None && stmt.op != Operation::Parameter ? (*this)[stmt.lhs].value : Scalar{0};
+            const Scalar y = stmt.rhs != None ? (*this)[stmt.rhs].value : Scalar{0};
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
-        {
-            this->lhs_->derivative(map, this->rhs_->value() * weight);
-            this->rhs_->derivative(map, this->lhs_->value() * weight);
+            switch(stmt.op)
+            {
+            case Operation::Parameter:
+            case Operation::Constant:
+            case Operation::Sum:
+            case Operation::Dot:
+            case Operation::SquaredNorm:
+            case Operation::External:
+            case Operation::Output:
+                break;
+            case Operation::Negate:
+                stmt.value = -x;
+                stmt.weightLhs = -1;
+                break;
+            case Operation::Add:
+                stmt.value = x + y;
+                stmt.weightLhs = 1;
+                stmt.weightRhs = 1;
+                break;
+            case Operation::Subtract:
+                stmt.value = x - y;
+                stmt.weightLhs = 1;
+                stmt.weightRhs = -1;
+                break;
+            case Operation::Multiply:
+                stmt.value = x * y;
+                stmt.weightLhs = y;
+                stmt.weightRhs = x;
+                break;
+            case Operation::Divide:
+                stmt.value = x / y;
+                stmt.weightLhs = 1 / y;
+                stmt.weightRhs = -x / (y * y);
+                break;
+            case Operation::AddScalar:
+                stmt.value = x + stmt.weightRhs;
+                stmt.weightLhs = 1;
+                break;
+            case Operation::SubtractScalar:
+                stmt.value = x - stmt.weightRhs;
+                stmt.weightLhs = 1;
+                break;
+            case Operation::ScalarSubtract:
+                stmt.value = stmt.weightRhs - x;
+                stmt.weightLhs = -1;
+                break;
+            case Operation::MultiplyScalar:
+                stmt.value = x * stmt.weightRhs;
+                stmt.weightLhs = stmt.weightRhs;
+                break;
+            case Operation::DivideScalar:
+                stmt.value = x / stmt.weightRhs;
+                stmt.weightLhs = 1 / stmt.weightRhs;
+                break;
+            case Operation::ScalarDivide:
+                stmt.value = stmt.weightRhs / x;
+                stmt.weightLhs = -stmt.weightRhs / (x * x);
+                break;
+            case Operation::Sin:
+                stmt.value = std::sin(x);
+                stmt.weightLhs = std::cos(x);
+                break;
+            case Operation::ArcSin:
+                stmt.value = std::asin(x);
+                stmt.weightLhs = 1 / std::sqrt(1 - x * x);
+                break;
+            case Operation::Cos:
+                stmt.value = std::cos(x);
+                stmt.weightLhs = -std::sin(x);
+                break;
+            case Operation::ArcCos:
+                stmt.value = std::acos(x);
+                stmt.weightLhs = -1 / std::sqrt(1 - x * x);
+                break;
+            case Operation::Tan:
+            {
+                const Scalar c = std::cos(x);
+                stmt.value = std::tan(x);
+                stmt.weightLhs = 1 / (c * c);
+                break;
+            }
+            case Operation::ArcTan:
+                stmt.value = std::atan(x);
+                stmt.weightLhs = 1 / (1 + x * x);
+                break;
+            case Operation::ArcTan2:
+            {
+                const Scalar denom = x * x + y * y;
+                stmt.value = std::atan2(x, y);
+                stmt.weightLhs = y / denom;
+                stmt.weightRhs = x / denom;
+                break;
+            }
+            case Operation::Exp:
+                stmt.value = std::exp(x);
+                stmt.weightLhs = stmt.value;
+                break;
+            case Operation::Sqrt:
+                stmt.value = std::sqrt(x);
+                stmt.weightLhs = 1 / (2 * stmt.value);
+                break;
+            case Operation::Abs:
+                stmt.value = std::abs(x);
+                stmt.weightLhs = 1;
+                break;
+            case Operation::Abs2:
+                stmt.value = x * x;
+                stmt.weightLhs = 2 * x;
+                break;
+            case Operation::Log:
+                stmt.value = std::log(x);
+                stmt.weightLhs = 1 / x;
+                break;
+            case Operation::Log2:
+                stmt.value = std::log2(x);
+                stmt.weightLhs = 1 / (x * std::log(Scalar{2}));
+                break;
+            case Operation::Pow:
+            {
+                const Scalar exponent = stmt.weightRhs;
+                stmt.value = std::pow(x, exponent);
+                stmt.weightLhs = exponent * std::pow(x, exponent - 1);
+                break;
+            }
+            case Operation::PowInt:
+            {
+                const int exponent = static_cast<int>(stmt.weightRhs);
+                stmt.value = std::pow(x, exponent);
+                stmt.weightLhs = exponent * std::pow(x, exponent - 1);
+                break;
+            }
+            }
         }
-    };
-
-    template<typename Scalar>
-    class Divide : public BinaryExpression<Scalar>
-    {
-    private:
-        Scalar weightLhs_;
-        Scalar weightRhs_;
-    public:
-        Divide(const std::shared_ptr<Expression<Scalar>> &lhs,
-            const std::shared_ptr<Expression<Scalar>> &rhs)
-            : BinaryExpression<Scalar>(lhs->value() / rhs->value(), lhs, rhs),
-            weightLhs_(1 / rhs->value()),
-            weightRhs_(-lhs->value() / (rhs->value() * rhs->value()))
-        { }
 
-        void derivative(std::map<std::string, Scalar> &map,
-            const Scalar weight) const override
+        Index push(const Operation op,
+            const Scalar value,
+            const Index lhs,
+            const Scalar weightLhs,
+            const Index rhs,
+            const Scalar weightRhs)
         {
-            this->lhs_->derivative(map, weightLhs_ * weight);
-            this->rhs_->derivative(map, weightRhs_ * weight);
+            if(size_ == capacity())
+                chunks_.push_back(pool_->acquire());
+
+            auto &stmt = (*this)[size_];
+            stmt.op = op;
+            stmt.lhs = lhs;
+            stmt.rhs = rhs;
+            stmt.value = value;
+            stmt.weightLhs = weightLhs;
+            stmt.weightRhs = weightRhs;
+
+            return size_++;
         }
     };
 
+    template<typename Scalar>
+    constexpr typename Tape<Scalar>::Index Tape<Scalar>::None;
+    template<typename Scalar>
+    constexpr typename Tape<Scalar>::Index Tape<Scalar>::ChunkBits;
+    template<typename Scalar>
+    constexpr typename Tape<Scalar>::Index Tape<Scalar>::ChunkSize;
+    template<typename Scalar>
+    constexpr typename Tape<Scalar>::Index Tape<Scalar>::ChunkMask;
+
+    /// @brief Generic number type for computing derivatives in backward mode.
+    /// Operations on numbers are recorded on the tape of their operands.
+    /// @tparam _Scalar internal scalar type
     template<typename _Scalar>
     class Number
     {
     public:
         using Scalar = _Scalar;
+        using Index = typename Tape<Scalar>::Index;
 
+        /// @brief Derivatives of a number w.r.t. the parameters of its tape,
+        /// stored densely by parameter index.
         class DerivativeMap
         {
         private:
-            std::map<std::string, Scalar> map_;
+            std::vector<Scalar> derivatives_;
         public:
-            std::map<std::string, Scalar> &map()
+            std::vector<Scalar> &values()
             {
-                return map_;
+                return derivatives_;
             }
 
             void clear()
             {
-                map_.clear();
+                derivatives_.clear();
             }
 
-            bool contains(const Number<Scalar> &value)
+            bool contains(const Number<Scalar> &value) const
             {
-                return map_.find(value.id()) != map_.end();
+                return value.parameter() < derivatives_.size();
             }
 
             Scalar operator()(const Number<Scalar> &value) const
             {
-                return map_.at(value.id());
+                if(!contains(value))
+                    throw std::out_of_range("number is no parameter of the derivative map");
+                return derivatives_[value.parameter()];
             }
         };
 
@@ -876,41 +3719,163 @@ namespace bwd
             : Number(Scalar{0})
         { }
 
-        Number(const Number &rhs) = default;
-        Number(Number &&rhs) = default;
-        ~Number() = default;
+        Number(const Number &rhs)
+            : tape_(rhs.tape_), index_(rhs.index_)
+        {
+#if !defined(NDEBUG)
+            generation_ = rhs.generation_;
+#endif
+            if(tape_ != nullptr)
+                tape_->acquire();
+        }
+
+        /// @brief Takes over the tape reference of rhs. Afterwards rhs has no
+        /// tape: it can be copied and assigned to, its value is zero and it
+        /// has no derivatives, but it must not be used in operations.
+        Number(Number &&rhs)
+            : tape_(rhs.tape_), index_(rhs.index_)
+        {
+#if !defined(NDEBUG)
+            generation_ = rhs.generation_;
+#endif
+            rhs.tape_ = nullptr;
+        }
+
+        ~Number()
+        {
+            if(tape_ != nullptr)
+                tape_->release();
+        }
 
         Number(const Scalar value)
-            : Number(std::make_shared<Parameter<Scalar>>(value))
+            : Number(Tape<Scalar>::active(), Tape<Scalar>::active().parameter(value))
         { }
 
-        Number(const std::shared_ptr<Expression<Scalar>> &expr)
-            : expr_(expr)
-        { }
+        Number(Tape<Scalar> &tape, const Index index)
+            : tape_(&tape), index_(index)
+        {
+#if !defined(NDEBUG)
+            generation_ = tape.generation();
+#endif
+            tape_->acquire();
+        }
 
         Scalar value() const
         {
-            return expr_->value();
+            assert(current());
+            return tape_ != nullptr ? (*tape_)[index_].value : Scalar{0};
         }
 
         void derivative(DerivativeMap &map) const
         {
-            map.clear();
-            expr_->derivative(map.map(), 1);
+            assert(current());
+            if(tape_ != nullptr)
+                tape_->derivative(map.values(), index_);
+            else
+                map.clear();
+        }
+
+        /// @brief Returns the parameter index of this number or Tape::None if
+        /// this number is no parameter.
+        Index parameter() const
+        {
+            assert(current());
+            if(tape_ == nullptr)
+                return Tape<Scalar>::None;
+            const auto &stmt = (*tape_)[index_];
+            return stmt.op == Operation::Parameter ? stmt.lhs : Tape<Scalar>::None;
+        }
+
+        /// @brief Returns the tape on which this number was recorded.
+        Tape<Scalar> &tape() const
+        {
+            return *tape_;
+        }
+
+        /// @brief Returns the index of the statement of this number on its tape.
+        Index index() const
+        {
+            assert(current());
+            return index_;
         }
 
-        const std::string &id() const
+        /// @brief Changes the value of this parameter. The tape has to be
+        /// replayed to propagate the new value to the recorded operations.
+        void setValue(const Scalar value)
         {
-            return expr_->id();
+            assert(parameter() != Tape<Scalar>::None);
+            (*tape_)[index_].value = value;
         }
 
-        const std::shared_ptr<Expression<Scalar>> &expression() const
+        /// @brief Records a unary operation on this number.
+        Number<Scalar> record(const Operation op, const Scalar argument = 0) const
         {
-            return expr_;
+            return Number<Scalar>(*tape_, tape_->record(op, index_, argument));
         }
 
-        Number<Scalar> &operator=(const Number<Scalar> &rhs) & = default;
-        Number<Scalar> &operator=(Number<Scalar> &&rhs) && = default;
+        /// @brief Records a binary operation with this number as left hand side.
+        Number<Scalar> record(const Operation op, const Number<Scalar> &rhs) const
+        {
+            assert(tape_ == rhs.tape_);
+            return Number<Scalar>(*tape_, tape_->record(op, index_, rhs.index_));
+        }
+
+        /// @brief Records a unary operation on this number and makes this
+        /// number refer to its result. Unlike record() this does not acquire
+        /// a new reference to the tape.
+        Number<Scalar> &recordInPlace(const Operation op, const Scalar argument = 0)
+        {
+            index_ = tape_->record(op, index_, argument);
+#if !defined(NDEBUG)
+            generation_ = tape_->generation();
+#endif
+            return *this;
+        }
+
+        /// @brief Records a binary operation and makes this number refer to
+        /// its result. This number may be one of the operands.
+        Number<Scalar> &recordInPlace(const Operation op,
+            const Number<Scalar> &lhs,
+            const Number<Scalar> &rhs)
+        {
+            assert(tape_ == lhs.tape_ && tape_ == rhs.tape_);
+            index_ = tape_->record(op, lhs.index_, rhs.index_);
+#if !defined(NDEBUG)
+            generation_ = tape_->generation();
+#endif
+            return *this;
+        }
+
+        /// @brief Records a comparison with this number as left hand side.
+        bool compare(const Comparison comparison, const Number<Scalar> &rhs) const
+        {
+            assert(tape_ == rhs.tape_);
+            return tape_->compare(comparison, index_, rhs.index_);
+        }
+
+        Number<Scalar> &operator=(const Number<Scalar> &rhs) &
+        {
+            if(rhs.tape_ != nullptr)
+                rhs.tape_->acquire();
+            if(tape_ != nullptr)
+                tape_->release();
+            tape_ = rhs.tape_;
+            index_ = rhs.index_;
+#if !defined(NDEBUG)
+            generation_ = rhs.generation_;
+#endif
+            return *this;
+        }
+
+        Number<Scalar> &operator=(Number<Scalar> &&rhs) &
+        {
+            std::swap(tape_, rhs.tape_);
+            std::swap(index_, rhs.index_);
+#if !defined(NDEBUG)
+            std::swap(generation_, rhs.generation_);
+#endif
+            return *this;
+        }
 
         Number<Scalar> &operator=(const Scalar rhs) &
         {
@@ -920,105 +3885,126 @@ namespace bwd
 
         Number<Scalar> &operator+=(const Scalar rhs)
         {
-            *this = *this * rhs;
-            return *this;
+            return recordInPlace(Operation::AddScalar, rhs);
         }
 
         Number<Scalar> &operator-=(const Scalar rhs)
         {
-            *this = *this - rhs;
-            return *this;
+            return recordInPlace(Operation::SubtractScalar, rhs);
         }
 
         Number<Scalar> &operator*=(const Scalar rhs)
         {
-            *this = *this * rhs;
-            return *this;
+            return recordInPlace(Operation::MultiplyScalar, rhs);
         }
 
         Number<Scalar> &operator/=(const Scalar rhs)
         {
-            *this = *this / rhs;
-            return *this;
+            return recordInPlace(Operation::DivideScalar, rhs);
         }
 
         Number<Scalar> &operator+=(const Number<Scalar> &rhs)
         {
-            *this = *this + rhs;
-            return *this;
+            return recordInPlace(Operation::Add, *this, rhs);
+        }
+
+        Number<Scalar> operator+(Number<Scalar> rhs) const &
+        {
+            rhs.recordInPlace(Operation::Add, *this, rhs);
+            return rhs;
         }
 
-        Number<Scalar> operator+(const Number<Scalar> &rhs) const
+        Number<Scalar> operator+(const Number<Scalar> &rhs) &&
         {
-            return Number<Scalar>(std::make_shared<Add<Scalar>>(expr_, rhs.expr_));
+            return std::move(recordInPlace(Operation::Add, *this, rhs));
         }
 
         Number<Scalar> &operator-=(const Number<Scalar> &rhs)
         {
-            *this = *this - rhs;
-            return *this;
+            return recordInPlace(Operation::Subtract, *this, rhs);
+        }
+
+        Number<Scalar> operator-(Number<Scalar> rhs) const &
+        {
+            rhs.recordInPlace(Operation::Subtract, *this, rhs);
+            return rhs;
         }
 
-        Number<Scalar> operator-(const Number<Scalar> &rhs) const
+        Number<Scalar> operator-(const Number<Scalar> &rhs) &&
         {
-            return Number<Scalar>(std::make_shared<Subtract<Scalar>>(expr_, rhs.expr_));
+            return std::move(recordInPlace(Operation::Subtract, *this, rhs));
         }
 
         Number<Scalar> &operator*=(const Number<Scalar> &rhs)
         {
-            *this = *this * rhs;
-            return *this;
+            return recordInPlace(Operation::Multiply, *this, rhs);
+        }
+
+        Number<Scalar> operator*(Number<Scalar> rhs) const &
+        {
+            rhs.recordInPlace(Operation::Multiply, *this, rhs);
+            return rhs;
         }
 
-        Number<Scalar> operator*(const Number<Scalar> &rhs) const
+        Number<Scalar> operator*(const Number<Scalar> &rhs) &&
         {
-            return Number<Scalar>(std::make_shared<Multiply<Scalar>>(expr_, rhs.expr_));
+            return std::move(recordInPlace(Operation::Multiply, *this, rhs));
         }
 
         Number<Scalar> &operator/=(const Number<Scalar> &rhs)
         {
-            *this = *this / rhs;
-            return *this;
+            return recordInPlace(Operation::Divide, *this, rhs);
+        }
+
+        Number<Scalar> operator/(Number<Scalar> rhs) const &
+        {
+            rhs.recordInPlace(Operation::Divide, *this, rhs);
+            return rhs;
+        }
+
+        Number<Scalar> operator/(const Number<Scalar> &rhs) &&
+        {
+            return std::move(recordInPlace(Operation::Divide, *this, rhs));
         }
 
-        Number<Scalar> operator/(const Number<Scalar> &rhs) const
+        Number<Scalar> operator-() const &
         {
-            return Number<Scalar>(std::make_shared<Divide<Scalar>>(expr_, rhs.expr_));
+            return record(Operation::Negate);
         }
 
-        Number<Scalar> operator-() const
+        Number<Scalar> operator-() &&
         {
-            return Number<Scalar>(std::make_shared<Negate<Scalar>>(expr_));
+            return std::move(recordInPlace(Operation::Negate));
         }
 
         bool operator==(const Number<Scalar> &rhs) const
         {
-            return value() == rhs.value();
+            return compare(Comparison::Equal, rhs);
         }
 
         bool operator!=(const Number<Scalar> &rhs) const
         {
-            return value() != rhs.value();
+            return compare(Comparison::NotEqual, rhs);
         }
 
         bool operator<(const Number<Scalar> &rhs) const
         {
-            return value() < rhs.value();
+            return compare(Comparison::Less, rhs);
         }
 
         bool operator<=(const Number<Scalar> &rhs) const
         {
-            return value() <= rhs.value();
+            return compare(Comparison::LessEqual, rhs);
         }
 
         bool operator>(const Number<Scalar> &rhs) const
         {
-            return value() > rhs.value();
+            return compare(Comparison::Greater, rhs);
         }
 
         bool operator>=(const Number<Scalar> &rhs) const
         {
-            return value() >= rhs.value();
+            return compare(Comparison::GreaterEqual, rhs);
         }
 
         explicit operator Scalar() const
@@ -1027,13 +4013,27 @@ namespace bwd
         }
 
     private:
-        std::shared_ptr<Expression<Scalar>> expr_;
+        Tape<Scalar> *tape_;
+        Index index_;
+#if !defined(NDEBUG)
+        /// Generation of the tape when index_ was assigned, see Tape::generation().
+        Index generation_;
+
+        /// @brief Checks that the statement of this number was not moved by
+        /// Tape::optimize(). Parameters keep their statement.
+        bool current() const
+        {
+            return tape_ == nullptr || generation_ == tape_->generation()
+                || (index_ < tape_->size() && (*tape_)[index_].op == Operation::Parameter);
+        }
+#endif
     };
 
     template<typename Scalar>
     inline Number<Scalar> constant(const Scalar value)
     {
-        return Number<Scalar>(std::make_shared<Constant<Scalar>>(value));
+        auto &tape = Tape<Scalar>::active();
+        return Number<Scalar>(tape, tape.constant(value));
     }
 
     template<typename Scalar>
@@ -1044,117 +4044,136 @@ namespace bwd
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator+(const Number<Scalar> &lhs, const Scalar rhs)
+    inline Number<Scalar> operator+(Number<Scalar> lhs, const Scalar rhs)
     {
-        return lhs + constant(rhs);
+        lhs.recordInPlace(Operation::AddScalar, rhs);
+        return lhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator+(const Scalar lhs, const Number<Scalar> &rhs)
+    inline Number<Scalar> operator+(const Scalar lhs, Number<Scalar> rhs)
     {
-        return constant(lhs) + rhs;
+        rhs.recordInPlace(Operation::AddScalar, lhs);
+        return rhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator-(const Number<Scalar> &lhs, const Scalar rhs)
+    inline Number<Scalar> operator-(Number<Scalar> lhs, const Scalar rhs)
     {
-        return lhs - constant(rhs);
+        lhs.recordInPlace(Operation::SubtractScalar, rhs);
+        return lhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator-(const Scalar lhs, const Number<Scalar> &rhs)
+    inline Number<Scalar> operator-(const Scalar lhs, Number<Scalar> rhs)
     {
-        return constant(lhs) - rhs;
+        rhs.recordInPlace(Operation::ScalarSubtract, lhs);
+        return rhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator*(const Number<Scalar> &lhs, const Scalar rhs)
+    inline Number<Scalar> operator*(Number<Scalar> lhs, const Scalar rhs)
     {
-        return lhs * constant(rhs);
+        lhs.recordInPlace(Operation::MultiplyScalar, rhs);
+        return lhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator*(const Scalar lhs, const Number<Scalar> &rhs)
+    inline Number<Scalar> operator*(const Scalar lhs, Number<Scalar> rhs)
     {
-        return constant(lhs) * rhs;
+        rhs.recordInPlace(Operation::MultiplyScalar, lhs);
+        return rhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator/(const Number<Scalar> &lhs, const Scalar rhs)
+    inline Number<Scalar> operator/(Number<Scalar> lhs, const Scalar rhs)
     {
-        return lhs / constant(rhs);
+        lhs.recordInPlace(Operation::DivideScalar, rhs);
+        return lhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> operator/(const Scalar lhs, const Number<Scalar> &rhs)
+    inline Number<Scalar> operator/(const Scalar lhs, Number<Scalar> rhs)
     {
-        return constant(lhs) / rhs;
+        rhs.recordInPlace(Operation::ScalarDivide, lhs);
+        return rhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> sin(const Number<Scalar> &value)
+    inline Number<Scalar> sin(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Sin<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Sin);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> asin(const Number<Scalar> &value)
+    inline Number<Scalar> asin(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<ArcSin<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::ArcSin);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> cos(const Number<Scalar> &value)
+    inline Number<Scalar> cos(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Cos<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Cos);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> acos(const Number<Scalar> &value)
+    inline Number<Scalar> acos(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<ArcCos<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::ArcCos);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> tan(const Number<Scalar> &value)
+    inline Number<Scalar> tan(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Tan<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Tan);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> atan(const Number<Scalar> &value)
+    inline Number<Scalar> atan(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<ArcTan<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::ArcTan);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> atan2(const Number<Scalar> &lhs, const Number<Scalar> &rhs)
+    inline Number<Scalar> atan2(Number<Scalar> lhs, const Number<Scalar> &rhs)
     {
-        return Number<Scalar>(std::make_shared<ArcTan2<Scalar>>(lhs.expression(), rhs.expression()));
+        lhs.recordInPlace(Operation::ArcTan2, lhs, rhs);
+        return lhs;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> exp(const Number<Scalar> &value)
+    inline Number<Scalar> exp(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Exp<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Exp);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> pow(const Number<Scalar> &value, const Scalar exponent)
+    inline Number<Scalar> pow(Number<Scalar> value, const Scalar exponent)
     {
-        return Number<Scalar>(std::make_shared<Pow<Scalar>>(value.expression(), exponent));
+        value.recordInPlace(Operation::Pow, exponent);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> pow(const Number<Scalar> &value, const int exponent)
+    inline Number<Scalar> pow(Number<Scalar> value, const int exponent)
     {
-        return Number<Scalar>(std::make_shared<PowInt<Scalar>>(value.expression(), exponent));
+        value.recordInPlace(Operation::PowInt, static_cast<Scalar>(exponent));
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> sqrt(const Number<Scalar> &value)
+    inline Number<Scalar> sqrt(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Sqrt<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Sqrt);
+        return value;
     }
 
     template<typename Scalar>
@@ -1172,31 +4191,152 @@ namespace bwd
     template<typename Scalar>
     inline Number<Scalar> imag(const Number<Scalar> &)
     {
-        return constant(0);
+        return constant(Scalar{0});
     }
 
     template<typename Scalar>
-    inline Number<Scalar> abs(const Number<Scalar> &value)
+    inline Number<Scalar> abs(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Abs<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Abs);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> abs2(const Number<Scalar> &value)
+    inline Number<Scalar> abs2(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Abs2<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Abs2);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> log(const Number<Scalar> &value)
+    inline Number<Scalar> log(Number<Scalar> value)
     {
-        return Number<Scalar>(std::make_shared<Log<Scalar>>(value.expression()));
+        value.recordInPlace(Operation::Log);
+        return value;
     }
 
     template<typename Scalar>
-    inline Number<Scalar> log2(const Number<Scalar> &value)
+    inline Number<Scalar> log2(Number<Scalar> value)
+    {
+        value.recordInPlace(Operation::Log2);
+        return value;
+    }
+
+    /// @brief Computes the sum of the given numbers, which is recorded as
+    /// a single n-ary statement.
+    template<typename Iterator>
+    inline typename std::iterator_traits<Iterator>::value_type sum(Iterator first, Iterator last)
+    {
+        using Number = typename std::iterator_traits<Iterator>::value_type;
+        using Scalar = typename Number::Scalar;
+
+        if(first == last)
+            return constant(Scalar{0});
+
+        auto &tape = first->tape();
+        for(; first != last; ++first)
+        {
+            assert(&first->tape() == &tape);
+            tape.operand(first->index());
+        }
+        return Number(tape, tape.recordNary(Operation::Sum));
+    }
+
+    template<typename Range>
+    inline auto sum(const Range &range) -> decltype(sum(std::begin(range), std::end(range)))
+    {
+        return sum(std::begin(range), std::end(range));
+    }
+
+    /// @brief Computes the dot product of the numbers in [first1, last1) and
+    /// the ones starting at first2, which is recorded as a single n-ary
+    /// statement.
+    template<typename Iterator1, typename Iterator2>
+    inline typename std::iterator_traits<Iterator1>::value_type dot(Iterator1 first1, Iterator1 last1, Iterator2 first2)
+    {
+        using Number = typename std::iterator_traits<Iterator1>::value_type;
+        using Scalar = typename Number::Scalar;
+
+        if(first1 == last1)
+            return constant(Scalar{0});
+
+        auto &tape = first1->tape();
+        for(auto it = first1; it != last1; ++it)
+        {
+            assert(&it->tape() == &tape);
+            tape.operand(it->index());
+        }
+        for(; first1 != last1; ++first1, ++first2)
+        {
+            assert(&first2->tape() == &tape);
+            tape.operand(first2->index());
+        }
+        return Number(tape, tape.recordNary(Operation::Dot));
+    }
+
+    template<typename Range1, typename Range2>
+    inline auto dot(const Range1 &lhs, const Range2 &rhs) -> decltype(dot(std::begin(lhs), std::end(lhs), std::begin(rhs)))
+    {
+        assert(std::distance(std::begin(lhs), std::end(lhs)) == std::distance(std::begin(rhs), std::end(rhs)));
+        return dot(std::begin(lhs), std::end(lhs), std::begin(rhs));
+    }
+
+    /// @brief Computes the sum of squares of the given numbers, which is
+    /// recorded as a single n-ary statement.
+    template<typename Iterator>
+    inline typename std::iterator_traits<Iterator>::value_type squaredNorm(Iterator first, Iterator last)
+    {
+        using Number = typename std::iterator_traits<Iterator>::value_type;
+        using Scalar = typename Number::Scalar;
+
+        if(first == last)
+            return constant(Scalar{0});
+
+        auto &tape = first->tape();
+        for(; first != last; ++first)
+        {
+            assert(&first->tape() == &tape);
+            tape.operand(first->index());
+        }
+        return Number(tape, tape.recordNary(Operation::SquaredNorm));
+    }
+
+    template<typename Range>
+    inline auto squaredNorm(const Range &range) -> decltype(squaredNorm(std::begin(range), std::end(range)))
+    {
+        return squaredNorm(std::begin(range), std::end(range));
+    }
+
+    /// @brief Optimizes the tape of the given numbers, see Tape::optimize(),
+    /// and makes them refer to their statements on the optimized tape. All
+    /// statements the numbers do not depend on are removed, so other numbers
+    /// recorded on the tape must not be used afterwards, except for the
+    /// parameters.
+    template<typename Iterator>
+    inline typename Tape<typename std::iterator_traits<Iterator>::value_type::Scalar>::Optimization
+    optimize(Iterator first, Iterator last)
+    {
+        using Number = typename std::iterator_traits<Iterator>::value_type;
+        using Index = typename Number::Index;
+
+        auto &tape = first == last ? Tape<typename Number::Scalar>::active() : first->tape();
+        std::vector<Index> outputs;
+        for(auto it = first; it != last; ++it)
+        {
+            assert(&it->tape() == &tape);
+            outputs.push_back(it->index());
+        }
+
+        const auto result = tape.optimize(outputs.data(), outputs.size());
+        for(Index k = 0; first != last; ++first, ++k)
+            *first = Number(tape, outputs[k]);
+        return result;
+    }
+
+    template<typename Range>
+    inline auto optimize(Range &range) -> decltype(optimize(std::begin(range), std::end(range)))
     {
-        return Number<Scalar>(std::make_shared<Log2<Scalar>>(value.expression()));
+        return optimize(std::begin(range), std::end(range));
     }
 
     template<typename Scalar>
@@ -1208,6 +4348,140 @@ namespace bwd
     typedef Number<double> Double;
     typedef Number<float> Float;
 }
+
+namespace internal
+{
+    /// @brief Function whose values and Jacobian are computed by a user
+    /// callback, see bwd::customFunction(). The Jacobian is kept from the
+    /// last evaluation for the reverse sweep.
+    template<typename Scalar, typename Callback>
+    class CustomJacobian : public bwd::Tape<Scalar>::Function
+    {
+    public:
+        CustomJacobian(const Callback &callback, const std::size_t inputs, const std::size_t outputs)
+            : callback_(callback), inputs_(inputs), outputs_(outputs), jacobian_(inputs * outputs)
+        { }
+
+        void evaluate(const Scalar *inputs, Scalar *outputs) override
+        {
+            callback_(inputs, outputs, jacobian_.data());
+        }
+
+        void adjoint(const Scalar *outputAdjoints, Scalar *inputAdjoints) const override
+        {
+            for(std::size_t j = 0; j < inputs_; ++j)
+            {
+                Scalar adjoint = 0;
+                for(std::size_t i = 0; i < outputs_; ++i)
+                    adjoint += jacobian_[i * inputs_ + j] * outputAdjoints[i];
+                inputAdjoints[j] = adjoint;
+            }
+        }
+
+    private:
+        Callback callback_;
+        std::size_t inputs_;
+        std::size_t outputs_;
+        std::vector<Scalar> jacobian_;
+    };
+
+    /// @brief Function whose values and vector Jacobian products are
+    /// computed by user callbacks, see bwd::customFunction(). The values of
+    /// the last evaluation are kept for the reverse sweep.
+    template<typename Scalar, typename Value, typename Adjoint>
+    class CustomAdjoint : public bwd::Tape<Scalar>::Function
+    {
+    public:
+        CustomAdjoint(const Value &value, const Adjoint &adjoint, const std::size_t inputs, const std::size_t outputs)
+            : value_(value), adjoint_(adjoint), values_(inputs + outputs), inputs_(inputs)
+        { }
+
+        void evaluate(const Scalar *inputs, Scalar *outputs) override
+        {
+            std::copy(inputs, inputs + inputs_, values_.begin());
+            value_(inputs, values_.data() + inputs_);
+            std::copy(values_.begin() + inputs_, values_.end(), outputs);
+        }
+
+        void adjoint(const Scalar *outputAdjoints, Scalar *inputAdjoints) const override
+        {
+            adjoint_(values_.data(), values_.data() + inputs_, outputAdjoints, inputAdjoints);
+        }
+
+    private:
+        Value value_;
+        Adjoint adjoint_;
+        std::vector<Scalar> values_;
+        std::size_t inputs_;
+    };
+
+    /// @brief Records the given function of the inputs on their tape and
+    /// returns its outputs.
+    template<typename Scalar>
+    inline std::vector<bwd::Number<Scalar>> recordCustom(typename bwd::Tape<Scalar>::Function *function,
+        const std::vector<bwd::Number<Scalar>> &inputs,
+        const std::size_t outputCount)
+    {
+        using Function = typename bwd::Tape<Scalar>::Function;
+        std::unique_ptr<Function> owner(function);
+
+        auto &tape = inputs.empty() ? bwd::Tape<Scalar>::active() : inputs.front().tape();
+        for(const auto &input : inputs)
+        {
+            assert(&input.tape() == &tape);
+            tape.operand(input.index());
+        }
+        const auto first = tape.recordFunction(std::move(owner), outputCount);
+
+        std::vector<bwd::Number<Scalar>> outputs;
+        outputs.reserve(outputCount);
+        for(std::size_t k = 0; k < outputCount; ++k)
+            outputs.emplace_back(tape, first + k);
+        return outputs;
+    }
+}
+
+namespace bwd
+{
+    /// @brief Records a function with several inputs and outputs as a single
+    /// statement, whose values and Jacobian are computed by the given
+    /// callback instead of being traced through scalar operations. The
+    /// callback is called again when the tape is replayed.
+    /// @param function callable function(inputs, outputs, jacobian) which
+    /// stores the values of the outputs and the row major Jacobian with one
+    /// row per output
+    /// @param inputs arguments of the function
+    /// @param outputCount number of outputs of the function
+    template<typename Function, typename Scalar>
+    inline std::vector<Number<Scalar>> customFunction(const Function &function,
+        const std::vector<Number<Scalar>> &inputs,
+        const std::size_t outputCount)
+    {
+        using Custom = internal::CustomJacobian<Scalar, typename std::decay<Function>::type>;
+        return internal::recordCustom(new Custom(function, inputs.size(), outputCount), inputs, outputCount);
+    }
+
+    /// @brief Records a function with several inputs and outputs as a single
+    /// statement, whose values and vector Jacobian products are computed by
+    /// the given callbacks. Only the values are computed while recording,
+    /// the adjoint callback is called by the reverse sweep.
+    /// @param value callable value(inputs, outputs) which stores the values
+    /// of the outputs
+    /// @param adjoint callable adjoint(inputs, outputs, outputAdjoints,
+    /// inputAdjoints) which stores the product of the transposed Jacobian
+    /// with the output adjoints
+    template<typename Value, typename Adjoint, typename Scalar>
+    inline std::vector<Number<Scalar>> customFunction(const Value &value,
+        const Adjoint &adjoint,
+        const std::vector<Number<Scalar>> &inputs,
+        const std::size_t outputCount)
+    {
+        using Custom = internal::CustomAdjoint<Scalar,
+            typename std::decay<Value>::type,
+            typename std::decay<Adjoint>::type>;
+        return internal::recordCustom(new Custom(value, adjoint, inputs.size(), outputCount), inputs, outputCount);
+    }
+}
 }
 
 #endif
@@ -10,59 +10,144 @@
 
 #include <adcpp/adcpp.hpp>
 #include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/LU>
+#include <Eigen/SparseCore>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace adcpp
+{
+namespace internal
+{
+    template<typename T>
+    struct NumTraits
+    {
+        using ValueType = typename T::Scalar;
+        using Real = T;
+        using NonInteger = T;
+        using Nested = T;
+        using Literal = T;
+        enum {
+            IsInteger = std::is_integral<ValueType>::value ? 1 : 0,
+            IsSigned = std::is_signed<ValueType>::value ? 1 : 0,
+            IsComplex = 0,
+            RequireInitialization = 1,
+            ReadCost = 1,
+            AddCost = 3,
+            MulCost = 3
+        };
+        static Real epsilon()
+        {
+            return Real(std::numeric_limits<ValueType>::epsilon());
+        }
+        static Real highest()
+        {
+            return Real(std::numeric_limits<ValueType>::max());
+        }
+        static Real lowest()
+        {
+            return Real(std::numeric_limits<ValueType>::min());
+        }
+        static Real min_exponent()
+        {
+            return Real(std::numeric_limits<ValueType>::min_exponent);
+        }
+        static Real max_exponent()
+        {
+            return Real(std::numeric_limits<ValueType>::max_exponent);
+        }
+        static Real digits()
+        {
+            return Real(std::numeric_limits<ValueType>::digits);
+        }
+        static Real digits10()
+        {
+            return Real(std::numeric_limits<ValueType>::digits10);
+        }
+    };
+
+    /// @brief Seeds forward mode numbers which propagate _Dim directions.
+    template<typename Scalar, int _Dim>
+    struct ForwardSeed
+    {
+        using Derivative = fwd::Tangent<Scalar, _Dim>;
+
+        /// @brief Returns the number of directions per evaluation for a
+        /// function with the given number of inputs.
+        static Eigen::Index chunk(const Eigen::Index)
+        {
+            return _Dim;
+        }
+
+        static Derivative unit(const Eigen::Index, const Eigen::Index direction)
+        {
+            return Derivative::Unit(direction);
+        }
+    };
+
+    template<typename Scalar>
+    struct ForwardSeed<Scalar, fwd::Dynamic>
+    {
+        using Derivative = fwd::Tangent<Scalar, fwd::Dynamic>;
+
+        static Eigen::Index chunk(const Eigen::Index inputs)
+        {
+            return std::max<Eigen::Index>(inputs, 1);
+        }
+
+        static Derivative unit(const Eigen::Index size, const Eigen::Index direction)
+        {
+            return Derivative::Unit(size, direction);
+        }
+    };
+
+    /// @brief Evaluates f with the inputs offset to offset + count seeded in
+    /// the directions of one chunk and stores the resulting columns of the
+    /// Jacobian. The inputs are restored to plain values afterwards.
+    template<int Chunk, typename Function, typename DerivedA, typename Vector, typename DerivedB>
+    inline void jacobianColumns(const Function &f,
+        const Eigen::MatrixBase<DerivedA> &x,
+        Vector &input,
+        const Eigen::Index offset,
+        const Eigen::Index count,
+        Eigen::MatrixBase<DerivedB> &jac)
+    {
+        using Scalar = typename DerivedA::Scalar;
+        using Seed = ForwardSeed<Scalar, Chunk>;
+        using Number = fwd::Number<Scalar, Chunk>;
+
+        const Eigen::Index chunk = Seed::chunk(x.size());
+        for(Eigen::Index k = 0; k < count; ++k)
+            input(offset + k) = Number(x(offset + k), Seed::unit(chunk, k));
+
+        const Vector output = f(input);
+        assert(jac.rows() == output.size());
+        for(Eigen::Index k = 0; k < count; ++k)
+            for(Eigen::Index i = 0; i < output.size(); ++i)
+                jac(i, offset + k) = output(i).derivative(k);
+
+        for(Eigen::Index k = 0; k < count; ++k)
+            input(offset + k) = Number(x(offset + k));
+    }
+}
+}
 
 #define ADCPP_GEN_NUMTRAITS(T) \
     template<>\
-    struct NumTraits<T>\
-    {\
-        using ValueType = T::Scalar;\
-        using Real = T;\
-        using NonInteger = T;\
-        using Nested = T;\
-        using Literal = T;\
-        enum {\
-            IsInteger = std::is_integral<ValueType>::value ? 1 : 0,\
-            IsSigned = std::is_signed<ValueType>::value ? 1 : 0,\
-            IsComplex = 0,\
-            RequireInitialization = 1,\
-            ReadCost = 1,\
-            AddCost = 3,\
-            MulCost = 3\
-        };\
-        static Real epsilon()\
-        {\
-            return Real(std::numeric_limits<ValueType>::epsilon());\
-        }\
-        static Real highest()\
-        {\
-            return Real(std::numeric_limits<ValueType>::max());\
-        }\
-        static Real lowest()\
-        {\
-            return Real(std::numeric_limits<ValueType>::min());\
-        }\
-        static Real min_exponent()\
-        {\
-            return Real(std::numeric_limits<ValueType>::min_exponent);\
-        }\
-        static Real max_exponent()\
-        {\
-            return Real(std::numeric_limits<ValueType>::max_exponent);\
-        }\
-        static Real digits()\
-        {\
-            return Real(std::numeric_limits<ValueType>::digits);\
-        }\
-        static Real digits10()\
-        {\
-            return Real(std::numeric_limits<ValueType>::digits10);\
-        }\
-    }
+    struct NumTraits<T> : adcpp::internal::NumTraits<T>\
+    { }
 
 namespace Eigen
 {
-    ADCPP_GEN_NUMTRAITS(adcpp::fwd::Double);
-    ADCPP_GEN_NUMTRAITS(adcpp::fwd::Float);
+    template<typename _Scalar, int _Dim>
+    struct NumTraits<adcpp::fwd::Number<_Scalar, _Dim>>
+        : adcpp::internal::NumTraits<adcpp::fwd::Number<_Scalar, _Dim>>
+    { };
 
     ADCPP_GEN_NUMTRAITS(adcpp::bwd::Double);
     ADCPP_GEN_NUMTRAITS(adcpp::bwd::Float);
@@ -70,6 +155,921 @@ namespace Eigen
 
 namespace adcpp
 {
+namespace internal
+{
+    /// @brief Adds the coefficients of an expression of backward mode
+    /// numbers to the given operand list. The coefficients are collected
+    /// before they are handed to the tape, because evaluating them may record
+    /// nested reductions, e.g. for lazy matrix products.
+    ///
+    /// The coefficients are visited by row and column in the given order
+    /// instead of the storage order of the expression, so the operands of
+    /// both sides of a product, e.g. a matrix and its transpose, are paired.
+    template<typename Derived, typename Index, typename Tape>
+    inline void reduxOperands(const Derived &xpr, const bool rowMajor, std::vector<Index> &operands, Tape *&tape)
+    {
+        Eigen::internal::evaluator<Derived> eval(xpr);
+        const Eigen::Index outer = rowMajor ? xpr.rows() : xpr.cols();
+        const Eigen::Index inner = rowMajor ? xpr.cols() : xpr.rows();
+        for(Eigen::Index i = 0; i < outer; ++i)
+        {
+            for(Eigen::Index j = 0; j < inner; ++j)
+            {
+                const auto value = rowMajor ? eval.coeff(i, j) : eval.coeff(j, i);
+                if(tape == nullptr)
+                    tape = &value.tape();
+                assert(tape == &value.tape());
+                operands.push_back(value.index());
+            }
+        }
+    }
+
+    template<typename Number, typename Index>
+    inline Number reduxRecord(bwd::Tape<typename Number::Scalar> &tape, const std::vector<Index> &operands, const bwd::Operation op)
+    {
+        for(const auto index : operands)
+            tape.operand(index);
+        return Number(tape, tape.recordNary(op));
+    }
+
+    /// @brief Records the sum of the coefficients of a generic expression.
+    template<typename Evaluator, typename XprType>
+    inline typename XprType::Scalar reduxSum(const Evaluator &eval, const XprType &xpr)
+    {
+        using Number = typename XprType::Scalar;
+        using Index = typename Number::Index;
+
+        bwd::Tape<typename Number::Scalar> *tape = nullptr;
+        std::vector<Index> operands;
+        operands.reserve(xpr.size());
+        for(Eigen::Index i = 0; i < xpr.outerSize(); ++i)
+        {
+            for(Eigen::Index j = 0; j < xpr.innerSize(); ++j)
+            {
+                const auto value = eval.coeffByOuterInner(i, j);
+                if(tape == nullptr)
+                    tape = &value.tape();
+                assert(tape == &value.tape());
+                operands.push_back(value.index());
+            }
+        }
+        return reduxRecord<Number>(*tape, operands, bwd::Operation::Sum);
+    }
+
+    /// @brief Records the sum of a coefficient wise product, as used by
+    /// dot() and lazy matrix products, as a dot product.
+    template<typename Evaluator, typename Func, typename Lhs, typename Rhs>
+    inline typename Eigen::CwiseBinaryOp<Func, Lhs, Rhs>::Scalar reduxDot(const Evaluator &,
+        const Eigen::CwiseBinaryOp<Func, Lhs, Rhs> &xpr)
+    {
+        using Number = typename Eigen::CwiseBinaryOp<Func, Lhs, Rhs>::Scalar;
+        using Index = typename Number::Index;
+
+        bwd::Tape<typename Number::Scalar> *tape = nullptr;
+        std::vector<Index> operands;
+        operands.reserve(2 * xpr.size());
+        const bool rowMajor = Eigen::CwiseBinaryOp<Func, Lhs, Rhs>::IsRowMajor;
+        reduxOperands(xpr.lhs(), rowMajor, operands, tape);
+        reduxOperands(xpr.rhs(), rowMajor, operands, tape);
+        return reduxRecord<Number>(*tape, operands, bwd::Operation::Dot);
+    }
+
+    template<typename Evaluator, typename Number, typename Lhs, typename Rhs>
+    inline Number reduxSum(const Evaluator &eval,
+        const Eigen::CwiseBinaryOp<Eigen::internal::scalar_conj_product_op<Number, Number>, Lhs, Rhs> &xpr)
+    {
+        return reduxDot(eval, xpr);
+    }
+
+    template<typename Evaluator, typename Number, typename Lhs, typename Rhs>
+    inline Number reduxSum(const Evaluator &eval,
+        const Eigen::CwiseBinaryOp<Eigen::internal::scalar_product_op<Number, Number>, Lhs, Rhs> &xpr)
+    {
+        return reduxDot(eval, xpr);
+    }
+
+    /// @brief Records the sum of squared coefficients, as used by
+    /// squaredNorm(), as a single statement.
+    template<typename Evaluator, typename Number, typename Nested>
+    inline Number reduxSum(const Evaluator &,
+        const Eigen::CwiseUnaryOp<Eigen::internal::scalar_abs2_op<Number>, Nested> &xpr)
+    {
+        using Index = typename Number::Index;
+
+        bwd::Tape<typename Number::Scalar> *tape = nullptr;
+        std::vector<Index> operands;
+        operands.reserve(xpr.size());
+        reduxOperands(xpr.nestedExpression(), Nested::IsRowMajor, operands, tape);
+        return reduxRecord<Number>(*tape, operands, bwd::Operation::SquaredNorm);
+    }
+
+    /// @brief Replaces the pairwise reduction of Eigen for sums of backward
+    /// mode numbers, so they are recorded as single n-ary statements.
+    template<typename Func, typename Evaluator>
+    struct ReduxSum
+    {
+        using Scalar = typename Evaluator::Scalar;
+
+        template<typename XprType>
+        static Scalar run(const Evaluator &eval, const Func &, const XprType &xpr)
+        {
+            assert(xpr.rows() > 0 && xpr.cols() > 0 && "you are using an empty matrix");
+            return reduxSum(eval, xpr);
+        }
+    };
+}
+}
+
+namespace adcpp
+{
+namespace internal
+{
+    /// @brief Base of functions which record dense matrix operations of
+    /// backward mode numbers as single tape statements. Inputs and outputs
+    /// are stored column major.
+    template<typename _Scalar>
+    class MatrixFunction : public bwd::Tape<_Scalar>::Function
+    {
+    public:
+        using Scalar = _Scalar;
+        using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+        using Map = Eigen::Map<Matrix>;
+        using ConstMap = Eigen::Map<const Matrix>;
+    };
+
+    /// @brief Matrix product res + alpha * lhs * rhs. Its inputs are lhs,
+    /// rhs, alpha and res in this order.
+    template<typename Scalar>
+    class MatrixProduct : public MatrixFunction<Scalar>
+    {
+    public:
+        using typename MatrixFunction<Scalar>::Matrix;
+        using typename MatrixFunction<Scalar>::Map;
+        using typename MatrixFunction<Scalar>::ConstMap;
+
+        MatrixProduct(const Eigen::Index rows, const Eigen::Index cols, const Eigen::Index depth)
+            : rows_(rows), cols_(cols), depth_(depth)
+        { }
+
+        void evaluate(const Scalar *inputs, Scalar *outputs) override
+        {
+            lhs_ = ConstMap(inputs, rows_, depth_);
+            rhs_ = ConstMap(inputs + rows_ * depth_, depth_, cols_);
+            alpha_ = inputs[rows_ * depth_ + depth_ * cols_];
+
+            Map res(outputs, rows_, cols_);
+            res = ConstMap(inputs + rows_ * depth_ + depth_ * cols_ + 1, rows_, cols_);
+            res.noalias() += alpha_ * lhs_ * rhs_;
+        }
+
+        void adjoint(const Scalar *outputs, Scalar *inputs) const override
+        {
+            const ConstMap adj(outputs, rows_, cols_);
+            const Matrix rhsAdj = lhs_.transpose() * adj;
+
+            Map(inputs, rows_, depth_).noalias() += alpha_ * adj * rhs_.transpose();
+            Map(inputs + rows_ * depth_, depth_, cols_) += alpha_ * rhsAdj;
+            inputs[rows_ * depth_ + depth_ * cols_] += rhsAdj.cwiseProduct(rhs_).sum();
+            Map(inputs + rows_ * depth_ + depth_ * cols_ + 1, rows_, cols_) += adj;
+        }
+
+        bool tangent(const Scalar *inputs, Scalar *outputs) const override
+        {
+            const ConstMap lhsTangent(inputs, rows_, depth_);
+            const ConstMap rhsTangent(inputs + rows_ * depth_, depth_, cols_);
+            const Scalar alphaTangent = inputs[rows_ * depth_ + depth_ * cols_];
+
+            Map res(outputs, rows_, cols_);
+            res = ConstMap(inputs + rows_ * depth_ + depth_ * cols_ + 1, rows_, cols_);
+            res.noalias() += alphaTangent * lhs_ * rhs_;
+            res.noalias() += alpha_ * lhsTangent * rhs_;
+            res.noalias() += alpha_ * lhs_ * rhsTangent;
+            return true;
+        }
+
+        /// The product is linear in each of lhs, rhs and alpha, so only
+        /// pairs of different factors have second order derivatives.
+        void curvature(const Scalar *outputs, const Scalar *tangents, Scalar *inputs) const override
+        {
+            const ConstMap adj(outputs, rows_, cols_);
+            const ConstMap lhsTangent(tangents, rows_, depth_);
+            const ConstMap rhsTangent(tangents + rows_ * depth_, depth_, cols_);
+            const Scalar alphaTangent = tangents[rows_ * depth_ + depth_ * cols_];
+
+            Map(inputs, rows_, depth_).noalias() += adj * (alpha_ * rhsTangent + alphaTangent * rhs_).transpose();
+            Map(inputs + rows_ * depth_, depth_, cols_).noalias() +=
+                (alpha_ * lhsTangent + alphaTangent * lhs_).transpose() * adj;
+            inputs[rows_ * depth_ + depth_ * cols_] += adj.cwiseProduct(lhsTangent * rhs_ + lhs_ * rhsTangent).sum();
+        }
+
+    private:
+        Eigen::Index rows_;
+        Eigen::Index cols_;
+        Eigen::Index depth_;
+        Matrix lhs_;
+        Matrix rhs_;
+        Scalar alpha_ = 0;
+    };
+
+    /// @brief Solution of a linear system a * x = b. Its inputs are a and b
+    /// in this order.
+    /// @tparam Decomposition either Eigen::PartialPivLU or Eigen::LLT, which
+    /// only reads the lower triangle of a
+    template<typename Scalar, typename Decomposition>
+    class LinearSolve : public MatrixFunction<Scalar>
+    {
+    public:
+        using typename MatrixFunction<Scalar>::Matrix;
+        using typename MatrixFunction<Scalar>::Map;
+        using typename MatrixFunction<Scalar>::ConstMap;
+
+        LinearSolve(const Eigen::Index size, const Eigen::Index cols)
+            : size_(size), cols_(cols)
+        { }
+
+        void evaluate(const Scalar *inputs, Scalar *outputs) override
+        {
+            decomposition_.compute(ConstMap(inputs, size_, size_));
+            x_ = decomposition_.solve(ConstMap(inputs + size_ * size_, size_, cols_));
+            Map(outputs, size_, cols_) = x_;
+        }
+
+        void adjoint(const Scalar *outputs, Scalar *inputs) const override
+        {
+            const Matrix bAdj = solveTransposed(decomposition_, ConstMap(outputs, size_, cols_));
+            const Matrix aAdj = -bAdj * x_.transpose();
+
+            addMatrixAdjoint(decomposition_, aAdj, Map(inputs, size_, size_));
+            Map(inputs + size_ * size_, size_, cols_) += bAdj;
+        }
+
+    private:
+        Eigen::Index size_;
+        Eigen::Index cols_;
+        Decomposition decomposition_;
+        Matrix x_;
+
+        static Matrix solveTransposed(const Eigen::PartialPivLU<Matrix> &lu, const ConstMap &rhs)
+        {
+            return lu.transpose().solve(rhs);
+        }
+
+        static Matrix solveTransposed(const Eigen::LLT<Matrix> &llt, const ConstMap &rhs)
+        {
+            return llt.solve(rhs);
+        }
+
+        static void addMatrixAdjoint(const Eigen::PartialPivLU<Matrix> &, const Matrix &adj, Map inputs)
+        {
+            inputs += adj;
+        }
+
+        static void addMatrixAdjoint(const Eigen::LLT<Matrix> &, const Matrix &adj, Map inputs)
+        {
+            // every coefficient of the lower triangle stands for itself and
+            // its mirrored coefficient
+            inputs.template triangularView<Eigen::Lower>() += adj;
+            inputs.template triangularView<Eigen::StrictlyLower>() += adj.transpose();
+        }
+    };
+
+    /// @brief Inverse of a square matrix.
+    template<typename Scalar>
+    class MatrixInverse : public MatrixFunction<Scalar>
+    {
+    public:
+        using typename MatrixFunction<Scalar>::Matrix;
+        using typename MatrixFunction<Scalar>::Map;
+        using typename MatrixFunction<Scalar>::ConstMap;
+
+        explicit MatrixInverse(const Eigen::Index size)
+            : size_(size)
+        { }
+
+        void evaluate(const Scalar *inputs, Scalar *outputs) override
+        {
+            inverse_ = ConstMap(inputs, size_, size_).partialPivLu().inverse();
+            Map(outputs, size_, size_) = inverse_;
+        }
+
+        void adjoint(const Scalar *outputs, Scalar *inputs) const override
+        {
+            const Matrix tmp = inverse_.transpose() * ConstMap(outputs, size_, size_);
+            Map(inputs, size_, size_).noalias() -= tmp * inverse_.transpose();
+        }
+
+    private:
+        Eigen::Index size_;
+        Matrix inverse_;
+    };
+
+    /// @brief Determinant of a square matrix.
+    template<typename Scalar>
+    class MatrixDeterminant : public MatrixFunction<Scalar>
+    {
+    public:
+        using typename MatrixFunction<Scalar>::Matrix;
+        using typename MatrixFunction<Scalar>::Map;
+        using typename MatrixFunction<Scalar>::ConstMap;
+
+        explicit MatrixDeterminant(const Eigen::Index size)
+            : size_(size)
+        { }
+
+        void evaluate(const Scalar *inputs, Scalar *outputs) override
+        {
+            lu_.compute(ConstMap(inputs, size_, size_));
+            outputs[0] = lu_.determinant();
+        }
+
+        void adjoint(const Scalar *outputs, Scalar *inputs) const override
+        {
+            Map(inputs, size_, size_) += (outputs[0] * lu_.determinant()) * lu_.inverse().transpose();
+        }
+
+    private:
+        Eigen::Index size_;
+        Eigen::PartialPivLU<Matrix> lu_;
+    };
+
+    /// @brief Records the matrix product res + alpha * lhs * rhs as a single
+    /// statement and stores its result in res. The matrices are accessed
+    /// through Eigen's BLAS data mappers.
+    template<typename Index, typename LhsMapper, typename RhsMapper, typename ResMapper, typename Scalar>
+    inline void recordProduct(const Index rows, const Index cols, const Index depth,
+        const LhsMapper &lhs, const RhsMapper &rhs, const ResMapper &res,
+        const bwd::Number<Scalar> &alpha)
+    {
+        if(rows == 0 || cols == 0 || depth == 0)
+            return;
+
+        auto &tape = alpha.tape();
+        for(Index j = 0; j < depth; ++j)
+            for(Index i = 0; i < rows; ++i)
+                tape.operand(lhs(i, j).index());
+        for(Index j = 0; j < cols; ++j)
+            for(Index i = 0; i < depth; ++i)
+                tape.operand(rhs(i, j).index());
+        tape.operand(alpha.index());
+        for(Index j = 0; j < cols; ++j)
+            for(Index i = 0; i < rows; ++i)
+                tape.operand(res(i, j).index());
+
+        using Function = typename bwd::Tape<Scalar>::Function;
+        const auto first = tape.recordFunction(std::unique_ptr<Function>(new MatrixProduct<Scalar>(rows, cols, depth)), rows * cols);
+        for(Index j = 0; j < cols; ++j)
+            for(Index i = 0; i < rows; ++i)
+                res(i, j) = bwd::Number<Scalar>(tape, first + j * rows + i);
+    }
+
+    /// @brief Replaces Eigen's matrix vector product kernel for backward
+    /// mode numbers.
+    template<typename Index, typename Scalar, typename LhsMapper, typename RhsMapper>
+    struct MatrixVectorProduct
+    {
+        using Number = bwd::Number<Scalar>;
+
+        static void run(Index rows, Index cols,
+            const LhsMapper &lhs,
+            const RhsMapper &rhs,
+            Number *res, Index resIncr,
+            Number alpha)
+        {
+            using ResMapper = Eigen::internal::blas_data_mapper<Number, Index, Eigen::ColMajor, Eigen::Unaligned, Eigen::Dynamic>;
+            recordProduct(rows, Index{1}, cols, lhs, rhs, ResMapper(res, rows * resIncr, resIncr), alpha);
+        }
+    };
+
+    /// @brief Adds the coefficients of a matrix to the operands of the
+    /// function which is recorded next.
+    template<typename Derived>
+    inline void matrixOperands(const Eigen::MatrixBase<Derived> &matrix)
+    {
+        for(Eigen::Index j = 0; j < matrix.cols(); ++j)
+            for(Eigen::Index i = 0; i < matrix.rows(); ++i)
+                matrix(i, j).tape().operand(matrix(i, j).index());
+    }
+
+    /// @brief Records a matrix function on all added operands and returns
+    /// its outputs as matrix of the given size.
+    template<typename Result, typename Scalar>
+    inline Result recordMatrixFunction(bwd::Tape<Scalar> &tape, MatrixFunction<Scalar> *function,
+        const Eigen::Index rows, const Eigen::Index cols)
+    {
+        using Function = typename bwd::Tape<Scalar>::Function;
+        const auto first = tape.recordFunction(std::unique_ptr<Function>(function), rows * cols);
+
+        Result result(rows, cols);
+        for(Eigen::Index j = 0; j < cols; ++j)
+            for(Eigen::Index i = 0; i < rows; ++i)
+                result(i, j) = bwd::Number<Scalar>(tape, first + j * rows + i);
+        return result;
+    }
+
+    template<typename Decomposition, typename DerivedA, typename DerivedB>
+    inline Eigen::Matrix<typename DerivedA::Scalar, DerivedA::ColsAtCompileTime, DerivedB::ColsAtCompileTime>
+    linearSolve(const Eigen::MatrixBase<DerivedA> &a, const Eigen::MatrixBase<DerivedB> &b)
+    {
+        using Result = Eigen::Matrix<typename DerivedA::Scalar, DerivedA::ColsAtCompileTime, DerivedB::ColsAtCompileTime>;
+        using Scalar = typename DerivedA::Scalar::Scalar;
+
+        assert(a.rows() == a.cols());
+        assert(a.rows() == b.rows());
+        if(a.size() == 0 || b.size() == 0)
+            return Result(a.cols(), b.cols());
+
+        // coefficients of expressions are evaluated first, since they may
+        // record statements themselves
+        const typename DerivedA::PlainObject lhs = a;
+        const typename DerivedB::PlainObject rhs = b;
+        matrixOperands(lhs);
+        matrixOperands(rhs);
+        return recordMatrixFunction<Result>(lhs(0, 0).tape(),
+            new LinearSolve<Scalar, Decomposition>(a.rows(), b.cols()), a.rows(), b.cols());
+    }
+
+    /// @brief Returns the number of time steps which can be reversed with
+    /// the given number of checkpoints if every step is recomputed at most
+    /// repetitions times, i.e. the binomial coefficient of
+    /// (checkpoints + repetitions) over checkpoints, saturated at limit.
+    inline std::size_t binomialSteps(const std::size_t checkpoints,
+        const std::size_t repetitions,
+        const std::size_t limit)
+    {
+        std::size_t steps = 1;
+        for(std::size_t i = 1; i <= checkpoints && steps < limit; ++i)
+            steps = steps * (repetitions + i) / i;
+        return std::min(steps, limit);
+    }
+
+    /// @brief Returns the step at which the next checkpoint is taken when
+    /// the steps begin to end are reversed with the given number of free
+    /// checkpoints. Following Griewank's binomial schedule, the remaining
+    /// steps on both sides can be reversed with the least number of
+    /// repetitions.
+    inline std::size_t binomialSplit(const std::size_t begin, const std::size_t end, const std::size_t checkpoints)
+    {
+        const std::size_t steps = end - begin;
+        std::size_t repetitions = 1;
+        while(binomialSteps(checkpoints, repetitions, steps) < steps)
+            ++repetitions;
+        const std::size_t right = binomialSteps(checkpoints - 1, repetitions, steps);
+        return begin + std::max<std::size_t>(steps - std::min(right, steps - 1), 1);
+    }
+
+    /// @brief Applies a step function to a state a given number of times
+    /// and computes its adjoint by binomial checkpointing.
+    ///
+    /// Every step is recorded on a separate tape and discarded right away,
+    /// so only the checkpointed states are kept. The forward evaluation
+    /// stores the checkpoints which the reversal of the last steps needs
+    /// first. The reverse sweep restores earlier states from the nearest
+    /// checkpoint and places new checkpoints on the way.
+    template<typename Scalar, typename Step>
+    class Checkpointing : public bwd::Tape<Scalar>::Function
+    {
+    public:
+        using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+        using NumberVector = Eigen::Matrix<bwd::Number<Scalar>, Eigen::Dynamic, 1>;
+
+        Checkpointing(const Step &step, const Eigen::Index size, const std::size_t steps, const std::size_t checkpoints)
+            : step_(step), size_(size), steps_(steps), checkpoints_(checkpoints)
+        { }
+
+        void evaluate(const Scalar *inputs, Scalar *outputs) override
+        {
+            stack_.clear();
+            stack_.push_back({0, Eigen::Map<const Vector>(inputs, size_)});
+
+            std::size_t begin = 0;
+            for(std::size_t available = checkpoints_; available > 0 && steps_ - begin > 1; --available)
+            {
+                const std::size_t split = binomialSplit(begin, steps_, available);
+                stack_.push_back({split, advance(stack_.back().state, begin, split)});
+                begin = split;
+            }
+
+            Eigen::Map<Vector>(outputs, size_) = advance(stack_.back().state, begin, steps_);
+        }
+
+        void adjoint(const Scalar *outputAdjoints, Scalar *inputAdjoints) const override
+        {
+            Vector adjoint = Eigen::Map<const Vector>(outputAdjoints, size_);
+            if(steps_ > 0)
+                reverse(0, 0, steps_, checkpoints_, adjoint);
+            Eigen::Map<Vector>(inputAdjoints, size_) = adjoint;
+        }
+
+    private:
+        struct Checkpoint
+        {
+            std::size_t step;
+            Vector state;
+        };
+
+        Step step_;
+        Eigen::Index size_;
+        std::size_t steps_;
+        std::size_t checkpoints_;
+        // checkpoints and the step tape are scratch space of the reverse sweep
+        mutable std::vector<Checkpoint> stack_;
+        mutable bwd::Tape<Scalar> tape_;
+        mutable std::vector<Scalar> derivatives_;
+
+        /// @brief Reverses the steps begin to end, whose first state is the
+        /// checkpoint at the given depth of the stack. The adjoint of the
+        /// state after the last step is replaced by that of the first.
+        void reverse(const std::size_t depth,
+            const std::size_t begin,
+            const std::size_t end,
+            const std::size_t available,
+            Vector &adjoint) const
+        {
+            if(end - begin == 1)
+            {
+                stepAdjoint(stack_[depth].state, adjoint);
+                return;
+            }
+
+            if(available == 0)
+            {
+                // no checkpoint left, restart from the first state every time
+                for(std::size_t step = end; step-- > begin;)
+                    stepAdjoint(advance(stack_[depth].state, begin, step), adjoint);
+                return;
+            }
+
+            const std::size_t split = binomialSplit(begin, end, available);
+            if(stack_.size() <= depth + 1 || stack_[depth + 1].step != split)
+            {
+                stack_.resize(depth + 1);
+                stack_.push_back({split, advance(stack_[depth].state, begin, split)});
+            }
+            reverse(depth + 1, split, end, available - 1, adjoint);
+            stack_.resize(depth + 1);
+            reverse(depth, begin, split, available, adjoint);
+        }
+
+        /// @brief Records the given state as parameters on the active tape.
+        NumberVector parameters(const Vector &state) const
+        {
+            // default constructed numbers are parameters already
+            NumberVector result(size_);
+            for(Eigen::Index i = 0; i < size_; ++i)
+                result(i).setValue(state(i));
+            return result;
+        }
+
+        /// @brief Returns the state after applying the steps begin to end to
+        /// the given state.
+        Vector advance(const Vector &state, const std::size_t begin, const std::size_t end) const
+        {
+            Vector result = state;
+            for(std::size_t step = begin; step < end; ++step)
+            {
+                typename bwd::Tape<Scalar>::ActiveScope scope(tape_);
+                const NumberVector output = step_(parameters(result));
+                assert(output.size() == size_);
+                for(Eigen::Index i = 0; i < size_; ++i)
+                    result(i) = output(i).value();
+            }
+            return result;
+        }
+
+        /// @brief Replaces the adjoint of the state after a step by the
+        /// adjoint of the given state before it.
+        void stepAdjoint(const Vector &state, Vector &adjoint) const
+        {
+            typename bwd::Tape<Scalar>::ActiveScope scope(tape_);
+            const NumberVector input = parameters(state);
+            const NumberVector output = step_(input);
+            assert(output.size() == size_);
+
+            std::vector<typename bwd::Tape<Scalar>::Index> outputs(size_);
+            for(Eigen::Index i = 0; i < size_; ++i)
+                outputs[i] = output(i).index();
+            tape_.derivative(derivatives_, outputs.data(), adjoint.data(), outputs.size());
+
+            for(Eigen::Index i = 0; i < size_; ++i)
+                adjoint(i) = derivatives_[input(i).parameter()];
+        }
+    };
+}
+}
+
+namespace adcpp
+{
+namespace internal
+{
+    /// @brief Colors items greedily such that items which share an entry
+    /// get different colors, e.g. rows of a sparsity pattern which have a
+    /// nonzero in the same column. Items with many entries are colored first.
+    /// @param items entries of every item
+    /// @param entryCount number of distinct entries
+    /// @param colors color of every item
+    /// @return number of colors
+    inline std::size_t colorGreedy(const std::vector<std::vector<std::size_t>> &items,
+        const std::size_t entryCount,
+        std::vector<std::size_t> &colors)
+    {
+        const std::size_t None = std::numeric_limits<std::size_t>::max();
+
+        std::vector<std::vector<std::size_t>> owners(entryCount);
+        for(std::size_t i = 0; i < items.size(); ++i)
+            for(const auto entry : items[i])
+                owners[entry].push_back(i);
+
+        std::vector<std::size_t> order(items.size());
+        for(std::size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+            [&items](const std::size_t lhs, const std::size_t rhs) { return items[lhs].size() > items[rhs].size(); });
+
+        colors.assign(items.size(), None);
+        // forbidden[c] holds the last item for which color c was taken
+        std::vector<std::size_t> forbidden;
+        std::size_t count = 0;
+        for(const auto i : order)
+        {
+            for(const auto entry : items[i])
+            {
+                for(const auto other : owners[entry])
+                {
+                    if(colors[other] != None)
+                        forbidden[colors[other]] = i;
+                }
+            }
+
+            std::size_t color = 0;
+            while(color < forbidden.size() && forbidden[color] == i)
+                ++color;
+            if(color == forbidden.size())
+                forbidden.push_back(None);
+            colors[i] = color;
+            count = std::max(count, color + 1);
+        }
+
+        return count;
+    }
+
+    /// @brief Determines the sparsity pattern of the Jacobian of the
+    /// recorded outputs f w.r.t. the parameters x. Afterwards rows[i] holds
+    /// the columns of the structural nonzeros of row i.
+    template<typename DerivedA, typename DerivedB>
+    inline void sparsityPattern(const Eigen::MatrixBase<DerivedA> &x,
+        const Eigen::MatrixBase<DerivedB> &f,
+        std::vector<std::vector<std::size_t>> &rows)
+    {
+        using Number = typename DerivedB::Scalar;
+        using Tape = bwd::Tape<typename Number::Scalar>;
+
+        rows.assign(f.size(), std::vector<std::size_t>());
+        if(f.size() == 0)
+            return;
+
+        std::vector<std::size_t> outputs(f.size());
+        for(Eigen::Index i = 0; i < f.size(); ++i)
+            outputs[i] = f(i).index();
+        const auto &tape = f(0).tape();
+        tape.sparsity(outputs.data(), outputs.size(), rows);
+
+        // translate parameter indices to columns and drop other parameters
+        std::vector<std::size_t> columns(tape.parameterCount(), Tape::None);
+        for(Eigen::Index j = 0; j < x.size(); ++j)
+        {
+            if(x(j).parameter() != Tape::None)
+                columns[x(j).parameter()] = j;
+        }
+        for(auto &row : rows)
+        {
+            std::size_t count = 0;
+            for(const auto parameter : row)
+            {
+                if(columns[parameter] != Tape::None)
+                    row[count++] = columns[parameter];
+            }
+            row.resize(count);
+        }
+    }
+}
+}
+
+namespace Eigen
+{
+namespace internal
+{
+    template<typename _Scalar, typename Evaluator>
+    struct redux_impl<scalar_sum_op<adcpp::bwd::Number<_Scalar>, adcpp::bwd::Number<_Scalar>>, Evaluator, DefaultTraversal, NoUnrolling>
+        : adcpp::internal::ReduxSum<scalar_sum_op<adcpp::bwd::Number<_Scalar>, adcpp::bwd::Number<_Scalar>>, Evaluator>
+    { };
+
+    template<typename _Scalar, typename Evaluator>
+    struct redux_impl<scalar_sum_op<adcpp::bwd::Number<_Scalar>, adcpp::bwd::Number<_Scalar>>, Evaluator, DefaultTraversal, CompleteUnrolling>
+        : adcpp::internal::ReduxSum<scalar_sum_op<adcpp::bwd::Number<_Scalar>, adcpp::bwd::Number<_Scalar>>, Evaluator>
+    { };
+
+    /// Dense matrix products of backward mode numbers are recorded as single
+    /// statements, whose adjoints are computed by plain matrix products.
+    template<typename Index, typename _Scalar, int LhsStorageOrder, bool ConjugateLhs,
+        int RhsStorageOrder, bool ConjugateRhs, int ResInnerStride>
+    struct general_matrix_matrix_product<Index, adcpp::bwd::Number<_Scalar>, LhsStorageOrder, ConjugateLhs,
+        adcpp::bwd::Number<_Scalar>, RhsStorageOrder, ConjugateRhs, ColMajor, ResInnerStride>
+    {
+        using Number = adcpp::bwd::Number<_Scalar>;
+        using Traits = gebp_traits<Number, Number>;
+
+        static void run(Index rows, Index cols, Index depth,
+            const Number *lhs, Index lhsStride,
+            const Number *rhs, Index rhsStride,
+            Number *res, Index resIncr, Index resStride,
+            Number alpha,
+            level3_blocking<Number, Number> &,
+            GemmParallelInfo<Index> * = 0)
+        {
+            adcpp::internal::recordProduct(rows, cols, depth,
+                const_blas_data_mapper<Number, Index, LhsStorageOrder>(lhs, lhsStride),
+                const_blas_data_mapper<Number, Index, RhsStorageOrder>(rhs, rhsStride),
+                blas_data_mapper<Number, Index, ColMajor, Unaligned, ResInnerStride>(res, resStride, resIncr),
+                alpha);
+        }
+    };
+
+    template<typename Index, typename _Scalar, typename LhsMapper, bool ConjugateLhs,
+        typename RhsMapper, bool ConjugateRhs, int Version>
+    struct general_matrix_vector_product<Index, adcpp::bwd::Number<_Scalar>, LhsMapper, ColMajor, ConjugateLhs,
+        adcpp::bwd::Number<_Scalar>, RhsMapper, ConjugateRhs, Version>
+        : adcpp::internal::MatrixVectorProduct<Index, _Scalar, LhsMapper, RhsMapper>
+    { };
+
+    template<typename Index, typename _Scalar, typename LhsMapper, bool ConjugateLhs,
+        typename RhsMapper, bool ConjugateRhs, int Version>
+    struct general_matrix_vector_product<Index, adcpp::bwd::Number<_Scalar>, LhsMapper, RowMajor, ConjugateLhs,
+        adcpp::bwd::Number<_Scalar>, RhsMapper, ConjugateRhs, Version>
+        : adcpp::internal::MatrixVectorProduct<Index, _Scalar, LhsMapper, RhsMapper>
+    { };
+}
+}
+
+namespace adcpp
+{
+    /// @brief Fixed set of worker threads which is reused by the parallel
+    /// derivative drivers. The workers live as long as the pool, so their
+    /// thread local tapes and chunk pools are reused across calls. Work is
+    /// either run once per worker or balanced over the workers by work
+    /// stealing.
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(const std::size_t threads)
+        {
+            for(std::size_t i = 0; i < std::max<std::size_t>(threads, 1); ++i)
+                threads_.emplace_back([this, i]() { work(i); });
+        }
+
+        ThreadPool(const ThreadPool &rhs) = delete;
+        ThreadPool &operator=(const ThreadPool &rhs) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for(auto &thread : threads_)
+                thread.join();
+        }
+
+        /// @brief Returns the pool shared by all drivers, which has one
+        /// worker per hardware thread.
+        static ThreadPool &global()
+        {
+            static ThreadPool pool(std::thread::hardware_concurrency());
+            return pool;
+        }
+
+        /// @brief Returns the number of workers.
+        std::size_t size() const
+        {
+            return threads_.size();
+        }
+
+        /// @brief Calls task(worker) once on every worker and waits until all
+        /// calls have returned. The first exception thrown by a task is
+        /// rethrown. Must not be called from within a task.
+        void run(const std::function<void(std::size_t)> &task)
+        {
+            std::lock_guard<std::mutex> submit(submit_);
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_ = &task;
+            pending_ = threads_.size();
+            error_ = nullptr;
+            ++generation_;
+            wake_.notify_all();
+            done_.wait(lock, [this]() { return pending_ == 0; });
+            task_ = nullptr;
+            if(error_)
+                std::rethrow_exception(error_);
+        }
+
+        /// @brief Calls task(item, worker) for every item in [0, count) and
+        /// waits until all calls have returned.
+        ///
+        /// The items are dealt out to the workers in contiguous ranges. Each
+        /// worker takes items from the front of its own range and, once it
+        /// runs dry, steals single items from the back of the ranges of the
+        /// other workers. Items of uneven cost are thereby balanced without
+        /// a shared queue.
+        void parallelFor(const std::size_t count, const std::function<void(std::size_t, std::size_t)> &task)
+        {
+            struct Range
+            {
+                std::mutex mutex;
+                std::size_t begin;
+                std::size_t end;
+            };
+
+            const std::size_t workers = threads_.size();
+            std::unique_ptr<Range[]> ranges(new Range[workers]);
+            for(std::size_t worker = 0; worker < workers; ++worker)
+            {
+                ranges[worker].begin = count * worker / workers;
+                ranges[worker].end = count * (worker + 1) / workers;
+            }
+
+            run([&](const std::size_t worker)
+            {
+                while(true)
+                {
+                    std::size_t item = count;
+                    {
+                        Range &own = ranges[worker];
+                        std::lock_guard<std::mutex> lock(own.mutex);
+                        if(own.begin < own.end)
+                            item = own.begin++;
+                    }
+
+                    for(std::size_t k = 1; k < workers && item == count; ++k)
+                    {
+                        Range &victim = ranges[(worker + k) % workers];
+                        std::lock_guard<std::mutex> lock(victim.mutex);
+                        if(victim.begin < victim.end)
+                            item = --victim.end;
+                    }
+
+                    if(item == count)
+                        return;
+                    task(item, worker);
+                }
+            });
+        }
+
+    private:
+        std::vector<std::thread> threads_;
+        std::mutex submit_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        const std::function<void(std::size_t)> *task_ = nullptr;
+        std::size_t pending_ = 0;
+        std::size_t generation_ = 0;
+        std::exception_ptr error_;
+        bool stop_ = false;
+
+        void work(const std::size_t worker)
+        {
+            std::size_t generation = 0;
+            while(true)
+            {
+                const std::function<void(std::size_t)> *task = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+                    if(stop_)
+                        return;
+                    generation = generation_;
+                    task = task_;
+                }
+
+                std::exception_ptr error;
+                try
+                {
+                    (*task)(worker);
+                }
+                catch(...)
+                {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(error && !error_)
+                    error_ = error;
+                if(--pending_ == 0)
+                    done_.notify_all();
+            }
+        }
+    };
+
 namespace fwd
 {
     typedef Eigen::Matrix<Double, Eigen::Dynamic, Eigen::Dynamic> MatrixXd;
@@ -95,6 +1095,169 @@ namespace fwd
     typedef Eigen::Matrix<Float, 3, 1> Vector3f;
     typedef Eigen::Matrix<Float, 4, 1> Vector4f;
     typedef Eigen::Matrix<Float, 5, 1> Vector5f;
+
+    /// @brief Computes the Jacobian of the vector valued function f at x.
+    /// The function is evaluated with numbers which propagate Chunk
+    /// directions at once, so n inputs take ceil(n / Chunk) evaluations.
+    /// Chunk may be Dynamic, which evaluates all directions in one pass.
+    /// @param f callable which maps an Eigen vector of
+    /// fwd::Number<Scalar, Chunk> to an Eigen vector of such numbers
+    /// @param x point at which the Jacobian is computed
+    /// @param jac output matrix with one row per output and one column per
+    /// input
+    template<int Chunk = 8, typename Function, typename DerivedA, typename DerivedB>
+    inline void jacobian(const Function &f,
+        const Eigen::MatrixBase<DerivedA> &x,
+        Eigen::MatrixBase<DerivedB> &jac)
+    {
+        using Scalar = typename DerivedA::Scalar;
+        using Seed = internal::ForwardSeed<Scalar, Chunk>;
+        using Vector = Eigen::Matrix<Number<Scalar, Chunk>, Eigen::Dynamic, 1>;
+
+        assert(jac.cols() == x.size());
+
+        const Eigen::Index chunk = Seed::chunk(x.size());
+        Vector input = x.template cast<Number<Scalar, Chunk>>();
+        for(Eigen::Index offset = 0; offset < x.size(); offset += chunk)
+            internal::jacobianColumns<Chunk>(f, x, input, offset, std::min(chunk, x.size() - offset), jac);
+    }
+
+    /// @brief Computes the Jacobian of the vector valued function f at x like
+    /// jacobian(), but evaluates the chunks of directions concurrently on the
+    /// workers of the pool. Every chunk writes its own block of columns of
+    /// jac. f is called from several threads at once.
+    template<int Chunk = 8, typename Function, typename DerivedA, typename DerivedB>
+    inline void parallelJacobian(const Function &f,
+        const Eigen::MatrixBase<DerivedA> &x,
+        Eigen::MatrixBase<DerivedB> &jac,
+        ThreadPool &pool = ThreadPool::global())
+    {
+        using Scalar = typename DerivedA::Scalar;
+        using Seed = internal::ForwardSeed<Scalar, Chunk>;
+        using Vector = Eigen::Matrix<Number<Scalar, Chunk>, Eigen::Dynamic, 1>;
+
+        assert(jac.cols() == x.size());
+
+        const Eigen::Index chunk = Seed::chunk(x.size());
+        const std::size_t chunks = static_cast<std::size_t>((x.size() + chunk - 1) / chunk);
+
+        // every worker seeds its own copy of the inputs
+        std::vector<Vector> inputs(pool.size());
+        pool.parallelFor(chunks, [&](const std::size_t item, const std::size_t worker)
+        {
+            Vector &input = inputs[worker];
+            if(input.size() != x.size())
+                input = x.template cast<Number<Scalar, Chunk>>();
+
+            const Eigen::Index offset = static_cast<Eigen::Index>(item) * chunk;
+            internal::jacobianColumns<Chunk>(f, x, input, offset, std::min(chunk, x.size() - offset), jac);
+        });
+    }
+
+    /// @brief Computes the gradient of the scalar valued function f at x.
+    /// The directions are evaluated in chunks as for jacobian().
+    /// @param f callable which maps an Eigen vector of
+    /// fwd::Number<Scalar, Chunk> to a single such number
+    template<int Chunk = 8, typename Function, typename DerivedA, typename DerivedB>
+    inline void gradient(const Function &f,
+        const Eigen::MatrixBase<DerivedA> &x,
+        Eigen::MatrixBase<DerivedB> &grad)
+    {
+        using Scalar = typename DerivedA::Scalar;
+        using Seed = internal::ForwardSeed<Scalar, Chunk>;
+        using Vector = Eigen::Matrix<Number<Scalar, Chunk>, Eigen::Dynamic, 1>;
+
+        assert(grad.size() == x.size());
+
+        const Eigen::Index chunk = Seed::chunk(x.size());
+        Vector input = x.template cast<Number<Scalar, Chunk>>();
+        for(Eigen::Index offset = 0; offset < x.size(); offset += chunk)
+        {
+            const Eigen::Index count = std::min(chunk, x.size() - offset);
+            for(Eigen::Index k = 0; k < count; ++k)
+                input(offset + k) = Number<Scalar, Chunk>(x(offset + k), Seed::unit(chunk, k));
+
+            const Number<Scalar, Chunk> output = f(input);
+            for(Eigen::Index k = 0; k < count; ++k)
+                grad(offset + k) = output.derivative(k);
+
+            for(Eigen::Index k = 0; k < count; ++k)
+                input(offset + k) = Number<Scalar, Chunk>(x(offset + k));
+        }
+    }
+
+    /// @brief Computes the sparse Jacobian of the vector valued function f
+    /// at x. The sparsity pattern is detected by recording f once in
+    /// backward mode, so f has to accept Eigen vectors of bwd::Number<Scalar>
+    /// as well. Inputs which do not share any output are seeded in the same
+    /// direction, so f is evaluated ceil(colors / Chunk) times instead of
+    /// ceil(n / Chunk) times. The pattern is only valid for the control flow
+    /// taken at x.
+    template<int Chunk = 8, typename Function, typename DerivedA, typename Scalar, int Options, typename StorageIndex>
+    inline void sparseJacobian(const Function &f,
+        const Eigen::MatrixBase<DerivedA> &x,
+        Eigen::SparseMatrix<Scalar, Options, StorageIndex> &jac)
+    {
+        using Seed = internal::ForwardSeed<Scalar, Chunk>;
+        using Vector = Eigen::Matrix<Number<Scalar, Chunk>, Eigen::Dynamic, 1>;
+        using Index = std::size_t;
+
+        std::vector<std::vector<Index>> rows;
+        {
+            using BackwardVector = Eigen::Matrix<bwd::Number<Scalar>, Eigen::Dynamic, 1>;
+            auto &tape = bwd::Tape<Scalar>::active();
+            const auto position = tape.size();
+            {
+                const BackwardVector input = x.template cast<bwd::Number<Scalar>>();
+                const BackwardVector output = f(input);
+                internal::sparsityPattern(input, output, rows);
+            }
+            // discard the recording unless it was already reset
+            if(tape.size() > position)
+                tape.reset(position);
+        }
+
+        jac.resize(rows.size(), x.size());
+        if(rows.empty() || x.size() == 0)
+            return;
+
+        // inputs share a color if no output depends on both of them
+        std::vector<std::vector<Index>> columns(x.size());
+        for(Index i = 0; i < rows.size(); ++i)
+            for(const auto j : rows[i])
+                columns[j].push_back(i);
+        std::vector<Index> colors;
+        const Eigen::Index colorCount = internal::colorGreedy(columns, rows.size(), colors);
+
+        std::vector<Eigen::Triplet<Scalar, StorageIndex>> triplets;
+        const Eigen::Index chunk = Seed::chunk(colorCount);
+        Vector input(x.size());
+        for(Eigen::Index offset = 0; offset < colorCount; offset += chunk)
+        {
+            const Eigen::Index count = std::min(chunk, colorCount - offset);
+            for(Eigen::Index j = 0; j < x.size(); ++j)
+            {
+                const Eigen::Index direction = static_cast<Eigen::Index>(colors[j]) - offset;
+                if(direction >= 0 && direction < count)
+                    input(j) = Number<Scalar, Chunk>(x(j), Seed::unit(chunk, direction));
+                else
+                    input(j) = Number<Scalar, Chunk>(x(j));
+            }
+
+            const Vector output = f(input);
+            assert(static_cast<Index>(output.size()) == rows.size());
+            for(Index i = 0; i < rows.size(); ++i)
+            {
+                for(const auto j : rows[i])
+                {
+                    const Eigen::Index direction = static_cast<Eigen::Index>(colors[j]) - offset;
+                    if(direction >= 0 && direction < count)
+                        triplets.emplace_back(i, j, output(i).derivative(direction));
+                }
+            }
+        }
+        jac.setFromTriplets(triplets.begin(), triplets.end());
+    }
 }
 
 namespace bwd
@@ -141,6 +1304,207 @@ namespace bwd
         }
     }
 
+    /// @brief Computes the product of the Hessian of the recorded number f
+    /// w.r.t. the parameters x with the direction v in forward over reverse
+    /// mode, which costs about as much as two gradients.
+    template<typename Scalar, typename DerivedA, typename DerivedB, typename DerivedC>
+    inline void hessianVectorProduct(const Eigen::MatrixBase<DerivedA> &x,
+        const Number<Scalar> &f,
+        const Eigen::MatrixBase<DerivedB> &v,
+        Eigen::MatrixBase<DerivedC> &hv)
+    {
+        assert(v.size() == x.size());
+        assert(hv.size() == x.size());
+
+        auto &tape = f.tape();
+        std::vector<Scalar> direction(tape.parameterCount(), Scalar{0});
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            if(x(i).parameter() != Tape<Scalar>::None)
+                direction[x(i).parameter()] = v(i);
+        }
+
+        std::vector<Scalar> gradient;
+        std::vector<Scalar> product;
+        tape.hessianVectorProduct(f.index(), direction, gradient, product);
+
+        hv.setZero();
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            if(x(i).parameter() != Tape<Scalar>::None)
+                hv(i) = product[x(i).parameter()];
+        }
+    }
+
+    /// @brief Computes the lower triangle of the Hessian of the recorded
+    /// number f w.r.t. the parameters x in a single edge pushing reverse
+    /// sweep. Only its structurally nonzero entries are stored in hes.
+    template<typename Scalar, typename DerivedA, typename SparseScalar, int Options, typename StorageIndex>
+    inline void hessian(const Eigen::MatrixBase<DerivedA> &x,
+        const Number<Scalar> &f,
+        Eigen::SparseMatrix<SparseScalar, Options, StorageIndex> &hes)
+    {
+        using Entry = typename Tape<Scalar>::HessianEntry;
+
+        auto &tape = f.tape();
+        std::vector<Scalar> gradient;
+        std::vector<Entry> entries;
+        tape.hessian(f.index(), gradient, entries);
+
+        // map the parameters to the columns of the hessian
+        std::vector<Eigen::Index> columns(tape.parameterCount(), -1);
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            if(x(i).parameter() != Tape<Scalar>::None)
+                columns[x(i).parameter()] = i;
+        }
+
+        std::vector<Eigen::Triplet<SparseScalar, StorageIndex>> triplets;
+        triplets.reserve(entries.size());
+        for(const auto &entry : entries)
+        {
+            Eigen::Index row = columns[entry.row];
+            Eigen::Index col = columns[entry.col];
+            if(row < 0 || col < 0)
+                continue;
+            if(row < col)
+                std::swap(row, col);
+            triplets.emplace_back(row, col, entry.value);
+        }
+
+        hes.resize(x.size(), x.size());
+        hes.setFromTriplets(triplets.begin(), triplets.end());
+    }
+
+    /// @brief Computes the full dense Hessian of the recorded number f w.r.t.
+    /// the parameters x in a single edge pushing reverse sweep.
+    template<typename Scalar, typename DerivedA, typename DerivedB>
+    inline void hessian(const Eigen::MatrixBase<DerivedA> &x,
+        const Number<Scalar> &f,
+        Eigen::MatrixBase<DerivedB> &hes)
+    {
+        assert(hes.rows() == x.size());
+        assert(hes.cols() == x.size());
+
+        Eigen::SparseMatrix<Scalar> lower;
+        hessian(x, f, lower);
+
+        hes.setZero();
+        for(Eigen::Index j = 0; j < lower.outerSize(); ++j)
+        {
+            for(typename Eigen::SparseMatrix<Scalar>::InnerIterator it(lower, j); it; ++it)
+            {
+                hes(it.row(), it.col()) = it.value();
+                hes(it.col(), it.row()) = it.value();
+            }
+        }
+    }
+
+    /// @brief Computes the sum of the losses f(x, batch) over all batches and
+    /// its gradient w.r.t. x, where f records a backward mode number.
+    ///
+    /// The batches are split into contiguous ranges, one per worker of the
+    /// pool. Each worker records on its own thread local tape and
+    /// accumulates the gradients of its range. The per worker results are
+    /// summed in worker order, so the result is deterministic for a given
+    /// pool size.
+    template<typename Function, typename Batch, typename DerivedA, typename DerivedB>
+    inline typename DerivedA::Scalar parallelGradient(const Function &f,
+        const Eigen::MatrixBase<DerivedA> &x,
+        const std::vector<Batch> &batches,
+        Eigen::MatrixBase<DerivedB> &grad,
+        ThreadPool &pool = ThreadPool::global())
+    {
+        assert(grad.size() == x.size());
+
+        using Scalar = typename DerivedA::Scalar;
+        using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+        using NumberVector = Eigen::Matrix<Number<Scalar>, Eigen::Dynamic, 1>;
+
+        const std::size_t workers = pool.size();
+        std::vector<Vector> gradients(workers, Vector::Zero(x.size()));
+        std::vector<Scalar> losses(workers, Scalar{0});
+
+        pool.run([&](const std::size_t worker)
+        {
+            const std::size_t begin = batches.size() * worker / workers;
+            const std::size_t end = batches.size() * (worker + 1) / workers;
+            if(begin == end)
+                return;
+
+            auto &tape = Tape<Scalar>::active();
+            // default constructed numbers are parameters already
+            NumberVector params(x.size());
+            for(long int i = 0; i < x.size(); ++i)
+                params(i).setValue(x(i));
+            const auto position = tape.size();
+
+            std::vector<Scalar> derivatives;
+            for(std::size_t b = begin; b < end; ++b)
+            {
+                {
+                    const Number<Scalar> loss = f(params, batches[b]);
+                    tape.derivative(derivatives, loss.index());
+                    losses[worker] += loss.value();
+                }
+                for(long int i = 0; i < x.size(); ++i)
+                    gradients[worker](i) += derivatives[params(i).parameter()];
+
+                // keep only the parameters for the next batch
+                tape.reset(position);
+            }
+        });
+
+        Scalar loss = 0;
+        grad.setZero();
+        for(std::size_t worker = 0; worker < workers; ++worker)
+        {
+            loss += losses[worker];
+            grad += gradients[worker];
+        }
+        return loss;
+    }
+
+    /// @brief Applies the step function to the state the given number of
+    /// times and records the whole loop as a single statement.
+    ///
+    /// Only the given number of intermediate states is kept as checkpoints.
+    /// The reverse sweep recomputes the steps in between following a
+    /// binomial schedule, so the memory is bounded by the number of
+    /// checkpoints while every step is recomputed a small number of times,
+    /// e.g. about log2(steps) times for log2(steps) checkpoints.
+    /// @param step callable which maps the state as Eigen vector of
+    /// bwd::Number<Scalar> to the next state. It is recorded on a separate
+    /// tape, so it must not use numbers other than its argument. Parameters
+    /// which stay constant over time can be carried in the state.
+    template<typename Step, typename Derived>
+    inline Eigen::Matrix<typename Derived::Scalar, Eigen::Dynamic, 1> checkpointed(const Step &step,
+        const Eigen::MatrixBase<Derived> &state,
+        const std::size_t steps,
+        const std::size_t checkpoints)
+    {
+        using Result = Eigen::Matrix<typename Derived::Scalar, Eigen::Dynamic, 1>;
+        using Scalar = typename Derived::Scalar::Scalar;
+        using Function = typename Tape<Scalar>::Function;
+        // plain functions are stored as function pointers
+        using Checkpointing = internal::Checkpointing<Scalar, typename std::decay<Step>::type>;
+
+        const Result input = state;
+        if(input.size() == 0)
+            return input;
+
+        auto &tape = input(0).tape();
+        for(Eigen::Index i = 0; i < input.size(); ++i)
+            tape.operand(input(i).index());
+        const auto first = tape.recordFunction(std::unique_ptr<Function>(
+            new Checkpointing(step, input.size(), steps, checkpoints)), input.size());
+
+        Result result(input.size());
+        for(Eigen::Index i = 0; i < input.size(); ++i)
+            result(i) = Number<Scalar>(tape, first + i);
+        return result;
+    }
+
     template<typename DerivedA, typename DerivedB, typename DerivedC>
     inline void jacobian(const Eigen::MatrixBase<DerivedA> &x,
         const Eigen::MatrixBase<DerivedB> &f,
@@ -149,17 +1513,123 @@ namespace bwd
         assert(jac.rows() == f.size());
         assert(jac.cols() == x.size());
 
-        typename Eigen::MatrixBase<DerivedB>::Scalar::DerivativeMap derivative;
+        using Number = typename Eigen::MatrixBase<DerivedB>::Scalar;
+        using Index = typename Number::Index;
+
         jac.setZero();
+        if(f.size() == 0)
+            return;
+
+        // propagate the adjoints of all outputs in a single reverse sweep
+        const Eigen::Matrix<Number, Eigen::Dynamic, 1> outputs = f;
+        std::vector<Index> indices(outputs.size());
+        for(long int i = 0; i < outputs.size(); ++i)
+            indices[i] = outputs(i).index();
+
+        auto &tape = outputs(0).tape();
+        tape.adjoints(indices.data(), indices.size());
+
+        for(long int j = 0; j < x.size(); ++j)
+        {
+            if(x(j).parameter() == Tape<typename Number::Scalar>::None)
+                continue;
+            for(long int i = 0; i < outputs.size(); ++i)
+                jac(i, j) = tape.adjoint(x(j).index(), i);
+        }
+    }
+
+    /// @brief Computes the sparse Jacobian of the recorded outputs f w.r.t.
+    /// the parameters x. The sparsity pattern is read from the tape and
+    /// outputs which do not share any parameter are seeded together, so the
+    /// reverse sweep propagates one adjoint per color instead of one per
+    /// output.
+    template<typename DerivedA, typename DerivedB, typename Scalar, int Options, typename StorageIndex>
+    inline void sparseJacobian(const Eigen::MatrixBase<DerivedA> &x,
+        const Eigen::MatrixBase<DerivedB> &f,
+        Eigen::SparseMatrix<Scalar, Options, StorageIndex> &jac)
+    {
+        using Number = typename Eigen::MatrixBase<DerivedB>::Scalar;
+        using Index = typename Number::Index;
+
+        jac.resize(f.size(), x.size());
+        if(f.size() == 0 || x.size() == 0)
+            return;
+
+        std::vector<std::vector<Index>> rows;
+        internal::sparsityPattern(x, f, rows);
+        std::vector<Index> colors;
+        const Index colorCount = internal::colorGreedy(rows, x.size(), colors);
+
+        std::vector<Index> outputs(f.size());
+        for(long int i = 0; i < f.size(); ++i)
+            outputs[i] = f(i).index();
+        auto &tape = f(0).tape();
+        tape.adjoints(outputs.data(), colors.data(), outputs.size(), colorCount);
+
+        std::vector<Eigen::Triplet<Scalar, StorageIndex>> triplets;
         for(long int i = 0; i < f.size(); ++i)
         {
-            f(i).derivative(derivative);
-            for(long int j = 0; j < x.size(); ++j)
-            {
-                if(derivative.contains(x(j)))
-                    jac(i, j) = derivative(x(j));
-            }
+            for(const auto j : rows[i])
+                triplets.emplace_back(i, j, tape.adjoint(x(j).index(), colors[i]));
         }
+        jac.setFromTriplets(triplets.begin(), triplets.end());
+    }
+
+    /// @brief Solves a * x = b with an LU decomposition with partial
+    /// pivoting. The solve is recorded as a single statement instead of
+    /// every operation of the decomposition.
+    template<typename DerivedA, typename DerivedB>
+    inline Eigen::Matrix<typename DerivedA::Scalar, DerivedA::ColsAtCompileTime, DerivedB::ColsAtCompileTime>
+    luSolve(const Eigen::MatrixBase<DerivedA> &a, const Eigen::MatrixBase<DerivedB> &b)
+    {
+        using Matrix = Eigen::Matrix<typename DerivedA::Scalar::Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+        return internal::linearSolve<Eigen::PartialPivLU<Matrix>>(a, b);
+    }
+
+    /// @brief Solves a * x = b with a Cholesky decomposition of the
+    /// symmetric positive definite matrix a, of which only the lower triangle
+    /// is used. The solve is recorded as a single statement.
+    template<typename DerivedA, typename DerivedB>
+    inline Eigen::Matrix<typename DerivedA::Scalar, DerivedA::ColsAtCompileTime, DerivedB::ColsAtCompileTime>
+    lltSolve(const Eigen::MatrixBase<DerivedA> &a, const Eigen::MatrixBase<DerivedB> &b)
+    {
+        using Matrix = Eigen::Matrix<typename DerivedA::Scalar::Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+        return internal::linearSolve<Eigen::LLT<Matrix>>(a, b);
+    }
+
+    /// @brief Computes the inverse of a square matrix, which is recorded as
+    /// a single statement.
+    template<typename Derived>
+    inline typename Derived::PlainObject inverse(const Eigen::MatrixBase<Derived> &a)
+    {
+        using Scalar = typename Derived::Scalar::Scalar;
+
+        assert(a.rows() == a.cols());
+        if(a.size() == 0)
+            return typename Derived::PlainObject(a.rows(), a.cols());
+
+        const typename Derived::PlainObject mat = a;
+        internal::matrixOperands(mat);
+        return internal::recordMatrixFunction<typename Derived::PlainObject>(mat(0, 0).tape(),
+            new internal::MatrixInverse<Scalar>(a.rows()), a.rows(), a.cols());
+    }
+
+    /// @brief Computes the determinant of a square matrix, which is recorded
+    /// as a single statement.
+    template<typename Derived>
+    inline typename Derived::Scalar determinant(const Eigen::MatrixBase<Derived> &a)
+    {
+        using Number = typename Derived::Scalar;
+        using Scalar = typename Number::Scalar;
+
+        assert(a.rows() == a.cols());
+        if(a.size() == 0)
+            return constant(Scalar{1});
+
+        const typename Derived::PlainObject mat = a;
+        internal::matrixOperands(mat);
+        return internal::recordMatrixFunction<Eigen::Matrix<Number, 1, 1>>(mat(0, 0).tape(),
+            new internal::MatrixDeterminant<Scalar>(a.rows()), 1, 1)(0, 0);
     }
 }
 }
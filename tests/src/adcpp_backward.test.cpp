@@ -6,6 +6,7 @@
 
 #include <catch2/catch.hpp>
 #include <adcpp/adcpp.hpp>
+#include <vector>
 
 using namespace adcpp;
 
@@ -44,6 +45,550 @@ TEMPLATE_TEST_CASE("backward algorithmic differentiation", "[backward]", float,
         REQUIRE(copy == fromScalar);
     }
 
+    SECTION("tape")
+    {
+        auto &tape = bwd::Tape<Scalar>::active();
+        REQUIRE(0 == tape.size());
+
+        {
+            ADScalar x(3);
+            ADScalar y(2);
+            ADScalar f = x * y + bwd::sin(x);
+            REQUIRE(5 == tape.size());
+
+            tape.reset(2);
+            REQUIRE(2 == tape.size());
+        }
+
+        const auto capacity = tape.capacity();
+        REQUIRE(0 == tape.size());
+        REQUIRE(0 < capacity);
+
+        {
+            ADScalar x(3);
+            ADScalar f = x * x;
+            REQUIRE(2 == tape.size());
+        }
+
+        REQUIRE(0 == tape.size());
+        REQUIRE(capacity == tape.capacity());
+    }
+
+    SECTION("move")
+    {
+        auto &tape = bwd::Tape<Scalar>::active();
+        {
+            ADScalar x(3);
+            ADScalar y(std::move(x));
+            REQUIRE(Approx(3).margin(eps) == y.value());
+
+            x = ADScalar(4);
+            y = std::move(x);
+            REQUIRE(Approx(4).margin(eps) == y.value());
+            REQUIRE(0 != tape.size());
+
+            // moved-from numbers have no tape but can still be copied
+            ADScalar a(1);
+            ADScalar b(std::move(a));
+            ADScalar c = a;
+            REQUIRE(Approx(0).margin(eps) == c.value());
+            REQUIRE(bwd::Tape<Scalar>::None == c.parameter());
+            c = a;
+            REQUIRE(Approx(0).margin(eps) == c.value());
+            c = b;
+            REQUIRE(Approx(1).margin(eps) == c.value());
+        }
+
+        // the moved references are released exactly once
+        REQUIRE(0 == tape.size());
+    }
+
+    SECTION("compound assignment")
+    {
+        typename ADScalar::DerivativeMap derivative;
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(3);
+        ADScalar y(2);
+
+        ADScalar f = x;
+        const auto size = tape.size();
+        f *= y;
+        REQUIRE(size + 1 == tape.size());
+        f += x;
+        f -= y;
+        f /= y;
+        f += Scalar{2};
+        f -= Scalar{1};
+        f *= Scalar{4};
+        f /= Scalar{2};
+
+        // f = (((x * y + x - y) / y) + 1) * 2
+        const Scalar valExp = ((3 * 2 + 3 - 2) / Scalar{2} + 1) * 2;
+        const Scalar gradXExp = (2 + 1) / Scalar{2} * 2;
+        const Scalar gradYExp = ((3 - 1) * 2 - (3 * 2 + 3 - 2)) / Scalar{4} * 2;
+        f.derivative(derivative);
+
+        REQUIRE(Approx(valExp).margin(eps) == f.value());
+        REQUIRE(Approx(gradXExp).margin(eps) == derivative(x));
+        REQUIRE(Approx(gradYExp).margin(eps) == derivative(y));
+        REQUIRE(Approx(3).margin(eps) == x.value());
+    }
+
+    SECTION("tape pool")
+    {
+        const auto pool = std::make_shared<typename bwd::Tape<Scalar>::Pool>();
+        std::size_t allocated;
+        {
+            bwd::Tape<Scalar> tape(pool);
+            ADScalar x(tape, tape.parameter(1));
+            ADScalar f = x;
+            for(int i = 0; i < 5000; ++i)
+                f = f + x;
+
+            allocated = pool->allocated();
+            REQUIRE(tape.capacity() == allocated);
+            REQUIRE(0 == pool->cached());
+            REQUIRE(allocated * sizeof(typename bwd::Tape<Scalar>::Statement) == pool->bytes());
+        }
+
+        // chunks of destroyed tapes are reused by new ones
+        REQUIRE(allocated == pool->cached());
+        {
+            bwd::Tape<Scalar> tape(pool);
+            ADScalar x(tape, tape.parameter(1));
+            REQUIRE(allocated == pool->allocated());
+            REQUIRE(allocated - tape.capacity() == pool->cached());
+        }
+
+        pool->trim();
+        REQUIRE(0 == pool->allocated());
+        REQUIRE(0 == pool->cached());
+    }
+
+    SECTION("parameter indices")
+    {
+        typename ADScalar::DerivativeMap derivative;
+        ADScalar x(3);
+        ADScalar y(2);
+        ADScalar f = x * y + Scalar{1};
+
+        REQUIRE(0 == x.parameter());
+        REQUIRE(1 == y.parameter());
+        REQUIRE(bwd::Tape<Scalar>::None == f.parameter());
+
+        f.derivative(derivative);
+
+        REQUIRE(2 == derivative.values().size());
+        REQUIRE(derivative.contains(x));
+        REQUIRE(derivative.contains(y));
+        REQUIRE(!derivative.contains(f));
+        REQUIRE(Approx(y.value()).margin(eps) == derivative(x));
+        REQUIRE(Approx(x.value()).margin(eps) == derivative(y));
+    }
+
+    SECTION("shared subexpressions")
+    {
+        typename ADScalar::DerivativeMap derivative;
+        ADScalar x(3);
+        ADScalar half(static_cast<Scalar>(0.5));
+
+        // every intermediate is used twice, so there are 2^100 paths from f to x
+        ADScalar f = x;
+        for(int i = 0; i < 100; ++i)
+            f = (f + f) * half;
+        f.derivative(derivative);
+
+        REQUIRE(Approx(x.value()).margin(eps) == f.value());
+        REQUIRE(Approx(1).margin(eps) == derivative(x));
+    }
+
+    SECTION("deep graph")
+    {
+        typename ADScalar::DerivativeMap derivative;
+        ADScalar x(1);
+
+        // a million sequential operations must neither overflow the stack
+        // during the reverse sweep nor during destruction
+        ADScalar f = x;
+        for(int i = 0; i < 1000000; ++i)
+            f = f + x;
+        f.derivative(derivative);
+
+        REQUIRE(Approx(1000001).margin(eps) == f.value());
+        REQUIRE(Approx(1000001).margin(eps) == derivative(x));
+    }
+
+    SECTION("replay")
+    {
+        typename ADScalar::DerivativeMap derivative;
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(2);
+        ADScalar y(3);
+
+        ADScalar f = x * bwd::sin(y) + bwd::pow(x, 3) / bwd::exp(y) + bwd::pow(y, Scalar{2.5});
+        const auto size = tape.size();
+
+        x.setValue(static_cast<Scalar>(0.5));
+        y.setValue(static_cast<Scalar>(1.5));
+        REQUIRE(tape.replay());
+        REQUIRE(size == tape.size());
+        f.derivative(derivative);
+
+        const Scalar xv = static_cast<Scalar>(0.5);
+        const Scalar yv = static_cast<Scalar>(1.5);
+        const Scalar valExp = xv * std::sin(yv) + xv * xv * xv / std::exp(yv) + std::pow(yv, Scalar{2.5});
+        const Scalar gradXExp = std::sin(yv) + 3 * xv * xv / std::exp(yv);
+        const Scalar gradYExp = xv * std::cos(yv) - xv * xv * xv / std::exp(yv) + Scalar{2.5} * std::pow(yv, Scalar{1.5});
+
+        REQUIRE(Approx(valExp).margin(eps) == f.value());
+        REQUIRE(Approx(gradXExp).margin(eps) == derivative(x));
+        REQUIRE(Approx(gradYExp).margin(eps) == derivative(y));
+    }
+
+    SECTION("replay with changed control flow")
+    {
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(1);
+        ADScalar y(2);
+
+        ADScalar f = x < y ? x * x : y;
+        REQUIRE(1 == tape.conditions().size());
+
+        x.setValue(static_cast<Scalar>(1.5));
+        REQUIRE(tape.replay());
+        REQUIRE(Approx(2.25).margin(eps) == f.value());
+
+        x.setValue(3);
+        REQUIRE(!tape.replay());
+    }
+
+    SECTION("scalar operands")
+    {
+        typename ADScalar::DerivativeMap derivative;
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(3);
+        const Scalar c = 2;
+
+        // scalars are stored inline, so every operation records one statement
+        const auto size = tape.size();
+        ADScalar f = (x + c) * (c - x) / c + c / x - x * c + (x - c) / (c * x);
+        REQUIRE(size + 12 == tape.size());
+
+        const Scalar xv = 3;
+        const Scalar valExp = (xv + c) * (c - xv) / c + c / xv - xv * c + (xv - c) / (c * xv);
+        const Scalar gradExp = ((c - xv) - (xv + c)) / c - c / (xv * xv) - c + c / (c * xv * xv);
+        f.derivative(derivative);
+
+        REQUIRE(Approx(valExp).margin(eps) == f.value());
+        REQUIRE(Approx(gradExp).margin(eps) == derivative(x));
+    }
+
+    SECTION("n-ary reductions")
+    {
+        typename ADScalar::DerivativeMap derivative;
+        auto &tape = bwd::Tape<Scalar>::active();
+        std::vector<ADScalar> x = {ADScalar(1), ADScalar(2), ADScalar(3)};
+        std::vector<ADScalar> y = {ADScalar(4), ADScalar(5), ADScalar(6)};
+
+        // each reduction records a single statement regardless of its length
+        const auto size = tape.size();
+        ADScalar s = bwd::sum(x);
+        ADScalar d = bwd::dot(x, y);
+        ADScalar n = bwd::squaredNorm(y);
+        REQUIRE(size + 3 == tape.size());
+
+        REQUIRE(Approx(6).margin(eps) == s.value());
+        REQUIRE(Approx(32).margin(eps) == d.value());
+        REQUIRE(Approx(77).margin(eps) == n.value());
+
+        ADScalar f = s * d + n;
+        f.derivative(derivative);
+        for(std::size_t i = 0; i < x.size(); ++i)
+        {
+            REQUIRE(Approx(32 + 6 * y[i].value()).margin(eps) == derivative(x[i]));
+            REQUIRE(Approx(6 * x[i].value() + 2 * y[i].value()).margin(eps) == derivative(y[i]));
+        }
+
+        // reductions over rvalues keep the recorded operands alive
+        ADScalar g = bwd::sum(std::vector<ADScalar>{x[0] * x[1], bwd::sin(x[2])});
+        g.derivative(derivative);
+        REQUIRE(Approx(2 + std::sin(Scalar(3))).margin(eps) == g.value());
+        REQUIRE(Approx(2).margin(eps) == derivative(x[0]));
+        REQUIRE(Approx(1).margin(eps) == derivative(x[1]));
+        REQUIRE(Approx(std::cos(Scalar(3))).margin(eps) == derivative(x[2]));
+
+        std::vector<ADScalar> empty;
+        REQUIRE(Approx(0).margin(eps) == bwd::sum(empty).value());
+    }
+
+    SECTION("hessian vector product")
+    {
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(Scalar(0.7));
+        ADScalar y(Scalar(1.3));
+        ADScalar f = bwd::sin(x * y) + bwd::exp(x) / y + bwd::sqrt(x) * bwd::log(y);
+
+        const Scalar xv = Scalar(0.7);
+        const Scalar yv = Scalar(1.3);
+        const Scalar sq = std::sqrt(xv);
+        const Scalar hxx = -yv * yv * std::sin(xv * yv) + std::exp(xv) / yv - std::log(yv) / (4 * xv * sq);
+        const Scalar hxy = std::cos(xv * yv) - xv * yv * std::sin(xv * yv) - std::exp(xv) / (yv * yv) + 1 / (2 * sq * yv);
+        const Scalar hyy = -xv * xv * std::sin(xv * yv) + 2 * std::exp(xv) / (yv * yv * yv) - sq / (yv * yv);
+
+        std::vector<Scalar> direction(tape.parameterCount(), Scalar{0});
+        direction[x.parameter()] = Scalar(0.5);
+        direction[y.parameter()] = Scalar(-2);
+        std::vector<Scalar> gradient;
+        std::vector<Scalar> product;
+        tape.hessianVectorProduct(f.index(), direction, gradient, product);
+
+        typename ADScalar::DerivativeMap derivative;
+        f.derivative(derivative);
+        REQUIRE(Approx(derivative(x)).margin(eps) == gradient[x.parameter()]);
+        REQUIRE(Approx(derivative(y)).margin(eps) == gradient[y.parameter()]);
+        REQUIRE(Approx(Scalar(0.5) * hxx - 2 * hxy).epsilon(1e-5).margin(eps) == product[x.parameter()]);
+        REQUIRE(Approx(Scalar(0.5) * hxy - 2 * hyy).epsilon(1e-5).margin(eps) == product[y.parameter()]);
+    }
+
+    SECTION("custom function")
+    {
+        // polar to cartesian coordinates with a hand coded Jacobian
+        const auto polar = [](const Scalar *x, Scalar *y, Scalar *jacobian)
+        {
+            y[0] = x[0] * std::cos(x[1]);
+            y[1] = x[0] * std::sin(x[1]);
+            jacobian[0] = std::cos(x[1]);
+            jacobian[1] = -x[0] * std::sin(x[1]);
+            jacobian[2] = std::sin(x[1]);
+            jacobian[3] = x[0] * std::cos(x[1]);
+        };
+        const auto polarValue = [](const Scalar *x, Scalar *y)
+        {
+            y[0] = x[0] * std::cos(x[1]);
+            y[1] = x[0] * std::sin(x[1]);
+        };
+        const auto polarAdjoint = [](const Scalar *x, const Scalar *, const Scalar *ya, Scalar *xa)
+        {
+            xa[0] = std::cos(x[1]) * ya[0] + std::sin(x[1]) * ya[1];
+            xa[1] = -x[0] * std::sin(x[1]) * ya[0] + x[0] * std::cos(x[1]) * ya[1];
+        };
+
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar r(2);
+        ADScalar phi(Scalar(0.5));
+        const std::vector<ADScalar> inputs{r, phi};
+
+        // reference traced through scalar operations
+        ADScalar fExp = r * bwd::cos(phi) * bwd::exp(r * bwd::sin(phi));
+        typename ADScalar::DerivativeMap derivativeExp;
+        fExp.derivative(derivativeExp);
+
+        const auto size = tape.size();
+        const auto outputs = bwd::customFunction(polar, inputs, 2);
+        REQUIRE(tape.size() - size == 3);
+        ADScalar f = outputs[0] * bwd::exp(outputs[1]);
+        typename ADScalar::DerivativeMap derivative;
+        f.derivative(derivative);
+        REQUIRE(Approx(fExp.value()).margin(eps) == f.value());
+        REQUIRE(Approx(derivativeExp(r)).margin(eps) == derivative(r));
+        REQUIRE(Approx(derivativeExp(phi)).margin(eps) == derivative(phi));
+
+        const auto adjointOutputs = bwd::customFunction(polarValue, polarAdjoint, inputs, 2);
+        ADScalar g = adjointOutputs[0] * bwd::exp(adjointOutputs[1]);
+        g.derivative(derivative);
+        REQUIRE(Approx(fExp.value()).margin(eps) == g.value());
+        REQUIRE(Approx(derivativeExp(r)).margin(eps) == derivative(r));
+        REQUIRE(Approx(derivativeExp(phi)).margin(eps) == derivative(phi));
+
+        // both kinds are evaluated again on replay
+        r.setValue(Scalar(3));
+        REQUIRE(tape.replay());
+        fExp.derivative(derivativeExp);
+        f.derivative(derivative);
+        REQUIRE(Approx(fExp.value()).margin(eps) == f.value());
+        REQUIRE(Approx(derivativeExp(phi)).margin(eps) == derivative(phi));
+        g.derivative(derivative);
+        REQUIRE(Approx(fExp.value()).margin(eps) == g.value());
+        REQUIRE(Approx(derivativeExp(r)).margin(eps) == derivative(r));
+    }
+
+    SECTION("optimize")
+    {
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(2);
+        ADScalar y(3);
+
+        const ADScalar c = bwd::exp(bwd::constant(Scalar{1})) * bwd::constant(Scalar{2});
+        const ADScalar f = bwd::sin(x * y) + bwd::sin(y * x) * c + -(-y);
+        const ADScalar unused = bwd::cos(x) * y;
+        REQUIRE(17 == tape.size());
+
+        std::vector<ADScalar> outputs{f};
+        const auto generation = tape.generation();
+        const auto result = bwd::optimize(outputs);
+        REQUIRE(generation + 1 == tape.generation());
+        REQUIRE(17 == result.before);
+        REQUIRE(8 == result.after);
+        REQUIRE(8 == tape.size());
+        REQUIRE(2 == result.folded);
+        REQUIRE(3 == result.merged);
+        REQUIRE(2 == tape.parameterCount());
+
+        const Scalar scale = 1 + 2 * std::exp(Scalar{1});
+        typename ADScalar::DerivativeMap derivative;
+        outputs[0].derivative(derivative);
+        REQUIRE(Approx(std::sin(Scalar{6}) * scale + 3).epsilon(eps) == outputs[0].value());
+        REQUIRE(Approx(3 * std::cos(Scalar{6}) * scale).epsilon(eps) == derivative(x));
+        REQUIRE(Approx(2 * std::cos(Scalar{6}) * scale + 1).epsilon(eps) == derivative(y));
+
+        x.setValue(Scalar{1});
+        REQUIRE(tape.replay());
+        outputs[0].derivative(derivative);
+        REQUIRE(Approx(std::sin(Scalar{3}) * scale + 3).epsilon(eps) == outputs[0].value());
+        REQUIRE(Approx(3 * std::cos(Scalar{3}) * scale).epsilon(eps) == derivative(x));
+        REQUIRE(Approx(std::cos(Scalar{3}) * scale + 1).epsilon(eps) == derivative(y));
+
+        // a second pass finds nothing left to do
+        const auto again = bwd::optimize(outputs);
+        REQUIRE(again.before == again.after);
+        REQUIRE(0 == again.folded);
+        REQUIRE(0 == again.merged);
+
+        // the operands of functions are forwarded to merged statements
+        const auto sum3 = [](const Scalar *in, Scalar *out, Scalar *jacobian)
+        {
+            out[0] = in[0] + in[1] + in[2];
+            jacobian[0] = 1;
+            jacobian[1] = 1;
+            jacobian[2] = 1;
+        };
+        const ADScalar a = x * y;
+        const ADScalar b = x * y;
+        std::vector<ADScalar> sums = bwd::customFunction(sum3, std::vector<ADScalar>{x, y, b}, 1);
+        sums[0] = sums[0] + a;
+        // both products are merged with the one of f
+        const auto merged = bwd::optimize(sums);
+        REQUIRE(2 == merged.merged);
+
+        sums[0].derivative(derivative);
+        REQUIRE(Approx(1 + 3 + 3 + 3).epsilon(eps) == sums[0].value());
+        REQUIRE(Approx(1 + 3 + 3).epsilon(eps) == derivative(x));
+        REQUIRE(Approx(1 + 1 + 1).epsilon(eps) == derivative(y));
+
+        x.setValue(Scalar{2});
+        REQUIRE(tape.replay());
+        REQUIRE(Approx(2 + 3 + 6 + 6).epsilon(eps) == sums[0].value());
+
+        // parameters recorded after removed statements keep their index
+        const ADScalar dead = bwd::exp(x) * y;
+        ADScalar z(Scalar{4});
+        std::vector<ADScalar> products{z * x};
+        const auto index = z.index();
+        bwd::optimize(products);
+        REQUIRE(index == z.index());
+        REQUIRE(3 == tape.parameterCount());
+
+        z.setValue(Scalar{5});
+        REQUIRE(tape.replay());
+        products[0].derivative(derivative);
+        REQUIRE(Scalar{5} == z.value());
+        REQUIRE(Approx(5 * 2).epsilon(eps) == products[0].value());
+        REQUIRE(Approx(2).epsilon(eps) == derivative(z));
+        REQUIRE(Approx(5).epsilon(eps) == derivative(x));
+    }
+
+    SECTION("hessian")
+    {
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(Scalar(0.7));
+        ADScalar y(Scalar(1.3));
+        ADScalar f = bwd::sin(x * y) + bwd::exp(x) / y + bwd::sqrt(x) * bwd::log(y) + x * x;
+
+        const Scalar xv = Scalar(0.7);
+        const Scalar yv = Scalar(1.3);
+        const Scalar sq = std::sqrt(xv);
+        const Scalar hxx = -yv * yv * std::sin(xv * yv) + std::exp(xv) / yv - std::log(yv) / (4 * xv * sq) + 2;
+        const Scalar hxy = std::cos(xv * yv) - xv * yv * std::sin(xv * yv) - std::exp(xv) / (yv * yv) + 1 / (2 * sq * yv);
+        const Scalar hyy = -xv * xv * std::sin(xv * yv) + 2 * std::exp(xv) / (yv * yv * yv) - sq / (yv * yv);
+
+        std::vector<Scalar> gradient;
+        std::vector<typename bwd::Tape<Scalar>::HessianEntry> entries;
+        tape.hessian(f.index(), gradient, entries);
+
+        typename ADScalar::DerivativeMap derivative;
+        f.derivative(derivative);
+        REQUIRE(Approx(derivative(x)).margin(eps) == gradient[x.parameter()]);
+        REQUIRE(Approx(derivative(y)).margin(eps) == gradient[y.parameter()]);
+
+        REQUIRE(entries.size() == 3);
+        for(const auto &entry : entries)
+        {
+            REQUIRE(entry.row >= entry.col);
+            if(entry.row != entry.col)
+                REQUIRE(Approx(hxy).epsilon(1e-5).margin(eps) == entry.value);
+            else if(entry.row == x.parameter())
+                REQUIRE(Approx(hxx).epsilon(1e-5).margin(eps) == entry.value);
+            else
+                REQUIRE(Approx(hyy).epsilon(1e-5).margin(eps) == entry.value);
+        }
+    }
+
+    SECTION("hessian with functions")
+    {
+        const auto square = [](const Scalar *in, Scalar *out, Scalar *jacobian)
+        {
+            out[0] = in[0] * in[0];
+            jacobian[0] = 2 * in[0];
+        };
+
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x(Scalar(0.5));
+        ADScalar y(Scalar(2));
+        const auto unrelated = bwd::customFunction(square, std::vector<ADScalar>{y}, 1);
+
+        // functions which the statement does not depend on are ignored
+        const ADScalar f = x * x * y;
+        std::vector<Scalar> gradient;
+        std::vector<typename bwd::Tape<Scalar>::HessianEntry> entries;
+        tape.hessian(f.index(), gradient, entries);
+        REQUIRE(entries.size() == 2);
+        REQUIRE(Approx(2 * 2).margin(eps) == entries[0].value);
+        REQUIRE(Approx(2 * Scalar(0.5)).margin(eps) == entries[1].value);
+
+        // functions without second order derivatives are rejected
+        const ADScalar g = unrelated[0] * x;
+        REQUIRE_THROWS_AS(tape.hessian(g.index(), gradient, entries), std::logic_error);
+    }
+
+    SECTION("hessian vector product with functions")
+    {
+        const auto square = [](const Scalar *in, Scalar *out, Scalar *jacobian)
+        {
+            out[0] = in[0] * in[0];
+            jacobian[0] = 2 * in[0];
+        };
+
+        auto &tape = bwd::Tape<Scalar>::active();
+        ADScalar x0(Scalar(0.5));
+        ADScalar x1(Scalar(2));
+        const auto unrelated = bwd::customFunction(square, std::vector<ADScalar>{x1}, 1);
+
+        // functions which the statement does not depend on are ignored
+        const ADScalar f = x0 * x0 * x1;
+        const std::vector<Scalar> direction = {Scalar(1), Scalar(-3)};
+        std::vector<Scalar> gradient;
+        std::vector<Scalar> product;
+        tape.hessianVectorProduct(f.index(), direction, gradient, product);
+        REQUIRE(Approx(2 * Scalar(0.5) * 2).margin(eps) == gradient[x0.parameter()]);
+        REQUIRE(Approx(Scalar(0.25)).margin(eps) == gradient[x1.parameter()]);
+        REQUIRE(Approx(2 * 2 - 3 * 2 * Scalar(0.5)).margin(eps) == product[x0.parameter()]);
+        REQUIRE(Approx(2 * Scalar(0.5)).margin(eps) == product[x1.parameter()]);
+
+        // functions without second order derivatives are rejected
+        const ADScalar g = unrelated[0] * x0;
+        REQUIRE_THROWS_AS(tape.hessianVectorProduct(g.index(), direction, gradient, product), std::logic_error);
+    }
+
     SECTION("add constant")
     {
         typename ADScalar::DerivativeMap derivative;
@@ -12,6 +12,24 @@
 
 using namespace adcpp;
 
+/// Explicit Euler step of a damped nonlinear oscillator, whose stiffness is
+/// carried as last component of the state.
+struct Oscillator
+{
+    std::size_t *calls;
+
+    bwd::VectorXd operator()(const bwd::VectorXd &state) const
+    {
+        ++*calls;
+        const bwd::Double dt(0.01);
+        bwd::VectorXd next(3);
+        next(0) = state(0) + dt * state(1);
+        next(1) = state(1) - dt * (state(2) * bwd::sin(state(0)) + bwd::Double(0.1) * state(1));
+        next(2) = state(2);
+        return next;
+    }
+};
+
 TEST_CASE("Eigen backward algorithmic differentiation")
 {
     double eps = 1e-6;
@@ -114,4 +132,522 @@ TEST_CASE("Eigen backward algorithmic differentiation")
         REQUIRE_MATRIX_APPROX(valExp, f.template cast<double>(), eps);
         REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
     }
+
+    SECTION("many outputs")
+    {
+        // outputs share subexpressions and depend on different inputs
+        bwd::VectorXd x(5);
+        for(long int i = 0; i < x.size(); ++i)
+            x(i) = bwd::Double(0.3 * (i + 1));
+
+        bwd::VectorXd f(9);
+        const bwd::Double s = bwd::sin(x(0) * x(1));
+        for(long int i = 0; i < f.size(); ++i)
+            f(i) = s * x(i % 5) + bwd::exp(x((i + 2) % 5) / bwd::Double(i + 1));
+
+        Eigen::MatrixXd jacExp(f.size(), x.size());
+        bwd::Double::DerivativeMap derivative;
+        for(long int i = 0; i < f.size(); ++i)
+        {
+            f(i).derivative(derivative);
+            for(long int j = 0; j < x.size(); ++j)
+                jacExp(i, j) = derivative(x(j));
+        }
+
+        Eigen::MatrixXd jacAct(f.size(), x.size());
+        jacobian(x, f, jacAct);
+
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+    }
+
+    SECTION("reductions")
+    {
+        bwd::VectorXd x(4);
+        bwd::VectorXd y(4);
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            x(i) = bwd::Double(0.5 * (i + 1));
+            y(i) = bwd::Double(2.0 - i);
+        }
+
+        // sum, dot and squaredNorm each record a single n-ary statement
+        auto &tape = bwd::Tape<double>::active();
+        const auto size = tape.size();
+        const bwd::Double s = x.sum();
+        const bwd::Double d = x.dot(y);
+        const bwd::Double n = y.squaredNorm();
+        REQUIRE(size + 3 == tape.size());
+
+        bwd::Vector3d f;
+        f << s, d, n;
+
+        Eigen::Vector3d valExp;
+        valExp << 5, 0, 6;
+        Eigen::MatrixXd jacExp(3, 8);
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            jacExp.col(i) << 1, y(i).value(), 0;
+            jacExp.col(i + 4) << 0, x(i).value(), 2 * y(i).value();
+        }
+
+        bwd::VectorXd xy(8);
+        xy << x, y;
+        Eigen::MatrixXd jacAct(3, 8);
+        bwd::jacobian(xy, f, jacAct);
+
+        REQUIRE_MATRIX_APPROX(valExp, f.template cast<double>(), eps);
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+    }
+
+    SECTION("reductions of expressions")
+    {
+        bwd::Vector3d x;
+        x << bwd::Double(1), bwd::Double(2), bwd::Double(3);
+        bwd::Matrix3d a;
+        a << bwd::Double(1), bwd::Double(2), bwd::Double(0),
+            bwd::Double(0), bwd::Double(1), bwd::Double(4),
+            bwd::Double(3), bwd::Double(0), bwd::Double(1);
+
+        bwd::Vector2d f;
+        f << (a * x).squaredNorm(), (x.array().exp() * x.array()).sum();
+
+        const Eigen::Vector3d ax = a.cast<double>() * x.cast<double>();
+        Eigen::Vector2d valExp;
+        valExp << ax.squaredNorm(), (x.cast<double>().array().exp() * x.cast<double>().array()).sum();
+        Eigen::MatrixXd jacExp(2, 3);
+        jacExp.row(0) = 2 * ax.transpose() * a.cast<double>();
+        for(long int i = 0; i < x.size(); ++i)
+            jacExp(1, i) = std::exp(x(i).value()) * (1 + x(i).value());
+
+        Eigen::MatrixXd jacAct(2, 3);
+        bwd::jacobian(x, f, jacAct);
+
+        REQUIRE_MATRIX_APPROX(valExp, f.template cast<double>(), eps);
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+    }
+
+    SECTION("reductions of matrices")
+    {
+        bwd::VectorXd x(9);
+        for(long int i = 0; i < x.size(); ++i)
+            x(i) = bwd::Double(0.5 * (i + 1) - 2);
+        const bwd::Matrix3d a = Eigen::Map<const bwd::Matrix3d>(x.data());
+        const Eigen::Matrix<bwd::Double, 3, 3, Eigen::RowMajor> r = a;
+
+        // transposed, block and row major operands are paired by coefficient
+        bwd::VectorXd f(5);
+        f << a.transpose().cwiseProduct(a).sum(),
+            a.block(0, 0, 2, 2).squaredNorm(),
+            a.norm(),
+            r.cwiseProduct(a).sum(),
+            (a.block(1, 1, 2, 2).array() * a.block(0, 0, 2, 2).array()).sum();
+
+        const Eigen::Matrix3d av = a.cast<double>();
+        Eigen::VectorXd valExp(5);
+        valExp << (av.transpose().array() * av.array()).sum(),
+            av.block(0, 0, 2, 2).array().square().sum(),
+            av.norm(),
+            av.array().square().sum(),
+            (av.block(1, 1, 2, 2).array() * av.block(0, 0, 2, 2).array()).sum();
+        Eigen::MatrixXd jacExp = Eigen::MatrixXd::Zero(5, 9);
+        for(long int j = 0; j < 3; ++j)
+        {
+            for(long int i = 0; i < 3; ++i)
+            {
+                const long int k = i + 3 * j;
+                jacExp(0, k) = 2 * av(j, i);
+                jacExp(1, k) = i < 2 && j < 2 ? 2 * av(i, j) : 0;
+                jacExp(2, k) = av(i, j) / av.norm();
+                jacExp(3, k) = 2 * av(i, j);
+                if(i < 2 && j < 2)
+                    jacExp(4, k) += av(i + 1, j + 1);
+                if(i > 0 && j > 0)
+                    jacExp(4, k) += av(i - 1, j - 1);
+            }
+        }
+
+        Eigen::MatrixXd jacAct(5, 9);
+        bwd::jacobian(x, f, jacAct);
+
+        REQUIRE_MATRIX_APPROX(valExp, f.template cast<double>(), eps);
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+    }
+
+    SECTION("matrix product")
+    {
+        // large enough to be evaluated by the matrix product kernels
+        bwd::MatrixXd a(8, 7);
+        bwd::MatrixXd b(7, 6);
+        for(long int i = 0; i < a.rows(); ++i)
+            for(long int j = 0; j < a.cols(); ++j)
+                a(i, j) = bwd::Double(std::sin(i + 2.0 * j));
+        for(long int i = 0; i < b.rows(); ++i)
+            for(long int j = 0; j < b.cols(); ++j)
+                b(i, j) = bwd::Double(std::cos(i * j + 1.0));
+
+        auto &tape = bwd::Tape<double>::active();
+        const auto size = tape.size();
+        const bwd::MatrixXd c = a * b;
+        const bwd::VectorXd v = a * b.col(0);
+        // one statement per output instead of one per multiply add
+        REQUIRE(tape.size() - size < static_cast<std::size_t>(3 * (c.size() + v.size())));
+
+        const bwd::MatrixXd cExp = a.lazyProduct(b);
+        const bwd::VectorXd vExp = a.lazyProduct(b.col(0));
+
+        bwd::VectorXd x(a.size() + b.size());
+        x << Eigen::Map<const bwd::VectorXd>(a.data(), a.size()),
+            Eigen::Map<const bwd::VectorXd>(b.data(), b.size());
+        bwd::VectorXd f(c.size() + v.size());
+        f << Eigen::Map<const bwd::VectorXd>(c.data(), c.size()), v;
+        bwd::VectorXd fExp(c.size() + v.size());
+        fExp << Eigen::Map<const bwd::VectorXd>(cExp.data(), cExp.size()), vExp;
+
+        Eigen::MatrixXd jacExp(f.size(), x.size());
+        bwd::jacobian(x, fExp, jacExp);
+        Eigen::MatrixXd jacAct(f.size(), x.size());
+        bwd::jacobian(x, f, jacAct);
+
+        REQUIRE_MATRIX_APPROX(fExp.template cast<double>(), f.template cast<double>(), eps);
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+    }
+
+    SECTION("linear solve")
+    {
+        bwd::Matrix2d a;
+        a << bwd::Double(4), bwd::Double(1),
+            bwd::Double(1), bwd::Double(3);
+        bwd::Vector2d b;
+        b << bwd::Double(1), bwd::Double(2);
+
+        // explicit solution of the 2x2 system
+        const bwd::Double det = a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0);
+        bwd::Vector2d xExp;
+        xExp << (a(1, 1) * b(0) - a(0, 1) * b(1)) / det,
+            (a(0, 0) * b(1) - a(1, 0) * b(0)) / det;
+        // the Cholesky decomposition only reads the lower triangle
+        const bwd::Double detSym = a(0, 0) * a(1, 1) - a(1, 0) * a(1, 0);
+        bwd::Vector2d xSymExp;
+        xSymExp << (a(1, 1) * b(0) - a(1, 0) * b(1)) / detSym,
+            (a(0, 0) * b(1) - a(1, 0) * b(0)) / detSym;
+
+        const bwd::Vector2d xLu = bwd::luSolve(a, b);
+        const bwd::Vector2d xLlt = bwd::lltSolve(a, b);
+
+        bwd::VectorXd p(6);
+        p << a(0, 0), a(1, 0), a(0, 1), a(1, 1), b(0), b(1);
+        Eigen::MatrixXd jacExp(2, 6);
+        Eigen::MatrixXd jacAct(2, 6);
+
+        bwd::jacobian(p, xExp, jacExp);
+        bwd::jacobian(p, xLu, jacAct);
+        REQUIRE_MATRIX_APPROX(xExp.template cast<double>(), xLu.template cast<double>(), eps);
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+
+        bwd::jacobian(p, xSymExp, jacExp);
+        bwd::jacobian(p, xLlt, jacAct);
+        REQUIRE_MATRIX_APPROX(xSymExp.template cast<double>(), xLlt.template cast<double>(), eps);
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+    }
+
+    SECTION("inverse and determinant")
+    {
+        bwd::Matrix2d a;
+        a << bwd::Double(2), bwd::Double(-1),
+            bwd::Double(0.5), bwd::Double(3);
+
+        const bwd::Double detExp = a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0);
+        bwd::Matrix2d invExp;
+        invExp << a(1, 1) / detExp, -a(0, 1) / detExp,
+            -a(1, 0) / detExp, a(0, 0) / detExp;
+
+        const bwd::Double det = bwd::determinant(a);
+        const bwd::Matrix2d inv = bwd::inverse(a);
+
+        bwd::VectorXd p(4);
+        p << a(0, 0), a(1, 0), a(0, 1), a(1, 1);
+        bwd::VectorXd f(5);
+        f << det, inv(0, 0), inv(1, 0), inv(0, 1), inv(1, 1);
+        bwd::VectorXd fExp(5);
+        fExp << detExp, invExp(0, 0), invExp(1, 0), invExp(0, 1), invExp(1, 1);
+
+        Eigen::MatrixXd jacExp(5, 4);
+        bwd::jacobian(p, fExp, jacExp);
+        Eigen::MatrixXd jacAct(5, 4);
+        bwd::jacobian(p, f, jacAct);
+
+        REQUIRE_MATRIX_APPROX(fExp.template cast<double>(), f.template cast<double>(), eps);
+        REQUIRE_MATRIX_APPROX(jacExp, jacAct, eps);
+    }
+
+    SECTION("replay matrix operations")
+    {
+        bwd::Matrix2d a;
+        a << bwd::Double(4), bwd::Double(1),
+            bwd::Double(2), bwd::Double(3);
+        bwd::Vector2d b;
+        b << bwd::Double(1), bwd::Double(2);
+
+        const bwd::Vector2d x = bwd::luSolve(a, b);
+        a(0, 0).setValue(5);
+        REQUIRE(bwd::Tape<double>::active().replay());
+
+        const Eigen::Vector2d xExp = a.cast<double>().partialPivLu().solve(b.cast<double>());
+        REQUIRE_MATRIX_APPROX(xExp, x.template cast<double>(), eps);
+    }
+
+    SECTION("sparse jacobian")
+    {
+        bwd::VectorXd x(10);
+        for(long int i = 0; i < x.size(); ++i)
+            x(i) = bwd::Double(0.1 * i);
+
+        // every output depends on its neighbouring inputs only
+        bwd::VectorXd f(x.size());
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            f(i) = bwd::Double(3) * x(i) * x(i);
+            if(i > 0)
+                f(i) = f(i) - x(i - 1);
+            if(i + 1 < x.size())
+                f(i) = f(i) + bwd::exp(x(i + 1));
+        }
+
+        Eigen::MatrixXd jacExp(f.size(), x.size());
+        bwd::jacobian(x, f, jacExp);
+
+        Eigen::SparseMatrix<double> jac;
+        bwd::sparseJacobian(x, f, jac);
+
+        REQUIRE(jac.nonZeros() == 28);
+        REQUIRE_MATRIX_APPROX(jacExp, Eigen::MatrixXd(jac), eps);
+    }
+
+    SECTION("hessian vector product")
+    {
+        bwd::VectorXd x(4);
+        x << bwd::Double(0.5), bwd::Double(-1), bwd::Double(2), bwd::Double(1.5);
+        Eigen::VectorXd v(4);
+        v << 1, 0.5, -2, 3;
+
+        // f = |x|^2 sum(x) has the Hessian 2 sum(x) I + 2 x 1^T + 2 1 x^T
+        const bwd::Double f = x.squaredNorm() * x.sum();
+
+        const Eigen::VectorXd xv = x.cast<double>();
+        const Eigen::MatrixXd hessian = 2 * xv.sum() * Eigen::MatrixXd::Identity(4, 4)
+            + 2 * xv * Eigen::RowVectorXd::Ones(4) + 2 * Eigen::VectorXd::Ones(4) * xv.transpose();
+        const Eigen::VectorXd hvExp = hessian * v;
+
+        Eigen::VectorXd hvAct(4);
+        bwd::hessianVectorProduct(x, f, v, hvAct);
+
+        REQUIRE_MATRIX_APPROX(hvExp, hvAct, eps);
+    }
+
+    SECTION("hessian")
+    {
+        bwd::VectorXd x(4);
+        x << bwd::Double(0.5), bwd::Double(-1), bwd::Double(2), bwd::Double(1.5);
+
+        const bwd::Double f = x.squaredNorm() * x.sum();
+
+        const Eigen::VectorXd xv = x.cast<double>();
+        const Eigen::MatrixXd hesExp = 2 * xv.sum() * Eigen::MatrixXd::Identity(4, 4)
+            + 2 * xv * Eigen::RowVectorXd::Ones(4) + 2 * Eigen::VectorXd::Ones(4) * xv.transpose();
+
+        Eigen::MatrixXd hesAct(4, 4);
+        bwd::hessian(x, f, hesAct);
+        REQUIRE_MATRIX_APPROX(hesExp, hesAct, eps);
+
+        Eigen::SparseMatrix<double> lower;
+        bwd::hessian(x, f, lower);
+        REQUIRE(lower.nonZeros() == 10);
+        const Eigen::MatrixXd lowerExp = hesExp.triangularView<Eigen::Lower>();
+        REQUIRE_MATRIX_APPROX(lowerExp, Eigen::MatrixXd(lower), eps);
+    }
+
+    SECTION("hessian of matrix products")
+    {
+        // f = |a * x|^2, where both factors are parameters
+        bwd::VectorXd p(12);
+        for(long int i = 0; i < p.size(); ++i)
+            p(i) = bwd::Double(0.3 * i - 1.1);
+        bwd::MatrixXd a(3, 3);
+        bwd::VectorXd x(3);
+        for(long int j = 0; j < 3; ++j)
+        {
+            for(long int i = 0; i < 3; ++i)
+                a(i, j) = p(i + 3 * j);
+            x(j) = p(9 + j);
+        }
+
+        const bwd::VectorXd y = a * x;
+        const bwd::Double f = y.squaredNorm();
+
+        const Eigen::MatrixXd av = a.cast<double>();
+        const Eigen::VectorXd xv = x.cast<double>();
+        const Eigen::VectorXd yv = av * xv;
+        Eigen::MatrixXd hesExp = Eigen::MatrixXd::Zero(12, 12);
+        hesExp.block(9, 9, 3, 3) = 2 * av.transpose() * av;
+        for(long int j = 0; j < 3; ++j)
+        {
+            for(long int i = 0; i < 3; ++i)
+            {
+                const long int ij = i + 3 * j;
+                for(long int l = 0; l < 3; ++l)
+                {
+                    hesExp(ij, i + 3 * l) = 2 * xv(j) * xv(l);
+                    hesExp(ij, 9 + l) = 2 * av(i, l) * xv(j) + (j == l ? 2 * yv(i) : 0);
+                    hesExp(9 + l, ij) = hesExp(ij, 9 + l);
+                }
+            }
+        }
+
+        Eigen::MatrixXd hesAct(12, 12);
+        bwd::hessian(p, f, hesAct);
+        REQUIRE_MATRIX_APPROX(hesExp, hesAct, eps);
+
+        Eigen::VectorXd v(12);
+        for(long int i = 0; i < v.size(); ++i)
+            v(i) = 0.5 - 0.2 * i;
+        const Eigen::VectorXd hvExp = hesExp * v;
+        Eigen::VectorXd hvAct(12);
+        bwd::hessianVectorProduct(p, f, v, hvAct);
+        REQUIRE_MATRIX_APPROX(hvExp, hvAct, eps);
+    }
+
+    SECTION("sparse hessian")
+    {
+        bwd::VectorXd x(6);
+        for(long int i = 0; i < x.size(); ++i)
+            x(i) = bwd::Double(0.25 * i + 0.5);
+
+        // chained interactions only couple neighbouring parameters
+        bwd::Double f = 0;
+        for(long int i = 0; i + 1 < x.size(); ++i)
+            f = f + x(i) * x(i) * x(i + 1);
+
+        const Eigen::VectorXd xv = x.cast<double>();
+        Eigen::MatrixXd hesExp = Eigen::MatrixXd::Zero(6, 6);
+        for(long int i = 0; i + 1 < x.size(); ++i)
+        {
+            hesExp(i, i) += 2 * xv(i + 1);
+            hesExp(i + 1, i) += 2 * xv(i);
+        }
+
+        Eigen::SparseMatrix<double> lower;
+        bwd::hessian(x, f, lower);
+        REQUIRE(lower.nonZeros() == 10);
+        REQUIRE_MATRIX_APPROX(hesExp, Eigen::MatrixXd(lower), eps);
+    }
+
+    SECTION("parallel gradient")
+    {
+        // fit a * exp(b t) + c against samples of sin(t), one batch per shard
+        std::vector<std::vector<double>> batches(7);
+        for(std::size_t b = 0; b < batches.size(); ++b)
+        {
+            for(std::size_t j = 0; j < 5 + b; ++j)
+                batches[b].push_back(0.1 * b + 0.03 * j);
+        }
+        const auto loss = [](const bwd::VectorXd &x, const std::vector<double> &batch)
+        {
+            bwd::Double result = 0;
+            for(const auto t : batch)
+            {
+                const bwd::Double r = x(0) * bwd::exp(bwd::Double(t) * x(1)) + x(2) - bwd::Double(std::sin(t));
+                result = result + r * r;
+            }
+            return result;
+        };
+
+        Eigen::VectorXd xv(3);
+        xv << 0.5, -0.3, 0.1;
+
+        double lossExp = 0;
+        Eigen::VectorXd gradExp = Eigen::VectorXd::Zero(3);
+        for(const auto &batch : batches)
+        {
+            const bwd::VectorXd x = xv.cast<bwd::Double>();
+            const bwd::Double f = loss(x, batch);
+            Eigen::VectorXd grad(3);
+            bwd::gradient(x, f, grad);
+            lossExp += f.value();
+            gradExp += grad;
+        }
+
+        auto &tape = bwd::Tape<double>::active();
+        const auto size = tape.size();
+
+        ThreadPool pool(3);
+        Eigen::VectorXd gradAct(3);
+        const double lossAct = bwd::parallelGradient(loss, xv, batches, gradAct, pool);
+
+        REQUIRE(Approx(lossExp).margin(eps) == lossAct);
+        REQUIRE_MATRIX_APPROX(gradExp, gradAct, eps);
+
+        // the workers record on their own tapes
+        REQUIRE(tape.size() == size);
+
+        // the result does not depend on the scheduling for a fixed pool size
+        Eigen::VectorXd gradRepeat(3);
+        REQUIRE(lossAct == bwd::parallelGradient(loss, xv, batches, gradRepeat, pool));
+        REQUIRE(gradAct == gradRepeat);
+
+        // more workers than batches
+        ThreadPool large(10);
+        bwd::parallelGradient(loss, xv, batches, gradAct, large);
+        REQUIRE_MATRIX_APPROX(gradExp, gradAct, eps);
+    }
+
+    SECTION("checkpointing")
+    {
+        const std::size_t steps = 100;
+        std::size_t calls = 0;
+        const Oscillator step{&calls};
+
+        bwd::VectorXd x(3);
+        x << bwd::Double(0.8), bwd::Double(0), bwd::Double(2);
+
+        // record every step on the tape as reference
+        bwd::VectorXd state = x;
+        for(std::size_t k = 0; k < steps; ++k)
+            state = step(state);
+        const bwd::Double fExp = state(0) * state(1);
+        Eigen::VectorXd gradExp(3);
+        bwd::gradient(x, fExp, gradExp);
+
+        for(const std::size_t checkpoints : {0, 1, 3, 7, 200})
+        {
+            auto &tape = x(0).tape();
+            const auto size = tape.size();
+
+            calls = 0;
+            const bwd::VectorXd result = bwd::checkpointed(step, x, steps, checkpoints);
+            const bwd::Double fAct = result(0) * result(1);
+            REQUIRE(calls == steps);
+
+            // the recorded statements do not depend on the number of steps
+            REQUIRE(tape.size() - size < 20);
+            REQUIRE(Approx(fExp.value()).margin(eps) == fAct.value());
+
+            calls = 0;
+            Eigen::VectorXd gradAct(3);
+            bwd::gradient(x, fAct, gradAct);
+            REQUIRE_MATRIX_APPROX(gradExp, gradAct, eps);
+
+            // seven checkpoints reverse 100 steps with three repetitions
+            if(checkpoints == 7)
+                REQUIRE(calls <= 4 * steps);
+            else if(checkpoints == 0)
+                REQUIRE(calls == steps * (steps + 1) / 2);
+        }
+
+        const bwd::VectorXd single = bwd::checkpointed(step, x, 1, 2);
+        Eigen::VectorXd grad(3);
+        bwd::gradient(x, single(1), grad);
+        REQUIRE(Approx(-0.01 * 2 * std::cos(0.8)).margin(eps) == grad(0));
+        REQUIRE(Approx(1 - 0.001).margin(eps) == grad(1));
+        REQUIRE(Approx(-0.01 * std::sin(0.8)).margin(eps) == grad(2));
+    }
 }
@@ -8,9 +8,62 @@
 #include <adcpp/adcpp_eigen.hpp>
 #include <Eigen/Geometry>
 #include <Eigen/Eigenvalues>
+#include "assert/eigen_require.hpp"
+#include <algorithm>
+#include <stdexcept>
 
 using namespace adcpp;
 
+struct Rosenbrock
+{
+    template<typename Derived>
+    typename Derived::Scalar operator()(const Eigen::MatrixBase<Derived> &x) const
+    {
+        using Number = typename Derived::Scalar;
+        Number result(0);
+        for(long int i = 0; i + 1 < x.size(); ++i)
+        {
+            const Number a = x(i + 1) - x(i) * x(i);
+            const Number b = Number(1) - x(i);
+            result += Number(100) * a * a + b * b;
+        }
+        return result;
+    }
+};
+
+struct Tridiagonal
+{
+    template<typename Derived>
+    Eigen::Matrix<typename Derived::Scalar, Eigen::Dynamic, 1> operator()(const Eigen::MatrixBase<Derived> &x) const
+    {
+        using Number = typename Derived::Scalar;
+        Eigen::Matrix<Number, Eigen::Dynamic, 1> result(x.size());
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            result(i) = Number(3) * x(i) * x(i);
+            if(i > 0)
+                result(i) -= x(i - 1);
+            if(i + 1 < x.size())
+                result(i) += exp(x(i + 1));
+        }
+        return result;
+    }
+};
+
+struct Trigonometric
+{
+    template<typename Derived>
+    Eigen::Matrix<typename Derived::Scalar, Eigen::Dynamic, 1> operator()(const Eigen::MatrixBase<Derived> &x) const
+    {
+        using Number = typename Derived::Scalar;
+        Eigen::Matrix<Number, Eigen::Dynamic, 1> result(x.size() + 1);
+        for(long int i = 0; i < x.size(); ++i)
+            result(i) = fwd::sin(x(i)) * x((i + 1) % x.size());
+        result(x.size()) = x.sum();
+        return result;
+    }
+};
+
 TEST_CASE("Eigen forward algorithmic differentiation")
 {
     double eps = 1e-6;
@@ -136,4 +189,143 @@ TEST_CASE("Eigen forward algorithmic differentiation")
         REQUIRE(Approx(jacExp(0, 1)).margin(eps) == fy(0).derivative());
         REQUIRE(Approx(jacExp(1, 1)).margin(eps) == fy(1).derivative());
     }
+
+    SECTION("multiple directions")
+    {
+        using Number = fwd::Number<double, 2>;
+        Eigen::Matrix<Number, 2, 1> x;
+        x << Number(3, Number::Derivative::Unit(0)), Number(2, Number::Derivative::Unit(1));
+
+        Eigen::Matrix2d c;
+        c << 2.1, 3.4,
+            1.6, 2.3;
+
+        Eigen::Vector2d valExp = c * x.cast<double>();
+
+        Eigen::Matrix<Number, 2, 1> f = c.cast<Number>() * x;
+
+        REQUIRE(Approx(valExp(0)).margin(eps) == f(0).value());
+        REQUIRE(Approx(valExp(1)).margin(eps) == f(1).value());
+
+        for(long int i = 0; i < 2; ++i)
+            for(long int j = 0; j < 2; ++j)
+                REQUIRE(Approx(c(i, j)).margin(eps) == f(i).derivative(j));
+    }
+
+    SECTION("gradient")
+    {
+        Eigen::VectorXd x(5);
+        x << 0.5, -1.2, 2.0, 0.3, 1.1;
+
+        Eigen::VectorXd gradExp(5);
+        gradExp.setZero();
+        for(long int i = 0; i + 1 < x.size(); ++i)
+        {
+            const double a = x(i + 1) - x(i) * x(i);
+            gradExp(i) += -400 * a * x(i) - 2 * (1 - x(i));
+            gradExp(i + 1) += 200 * a;
+        }
+
+        // chunk sizes which divide the inputs, leave a remainder or take all
+        Eigen::VectorXd grad(5);
+        fwd::gradient<1>(Rosenbrock(), x, grad);
+        REQUIRE_MATRIX_APPROX(gradExp, grad, eps);
+        fwd::gradient<2>(Rosenbrock(), x, grad);
+        REQUIRE_MATRIX_APPROX(gradExp, grad, eps);
+        fwd::gradient(Rosenbrock(), x, grad);
+        REQUIRE_MATRIX_APPROX(gradExp, grad, eps);
+        fwd::gradient<fwd::Dynamic>(Rosenbrock(), x, grad);
+        REQUIRE_MATRIX_APPROX(gradExp, grad, eps);
+    }
+
+    SECTION("jacobian")
+    {
+        Eigen::VectorXd x(4);
+        x << 0.5, -1.2, 2.0, 0.3;
+
+        Eigen::MatrixXd jacExp(5, 4);
+        jacExp.setZero();
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            const long int j = (i + 1) % x.size();
+            jacExp(i, i) += std::cos(x(i)) * x(j);
+            jacExp(i, j) += std::sin(x(i));
+            jacExp(4, i) = 1;
+        }
+
+        Eigen::MatrixXd jac(5, 4);
+        fwd::jacobian<3>(Trigonometric(), x, jac);
+        REQUIRE_MATRIX_APPROX(jacExp, jac, eps);
+        fwd::jacobian(Trigonometric(), x, jac);
+        REQUIRE_MATRIX_APPROX(jacExp, jac, eps);
+        fwd::jacobian<fwd::Dynamic>(Trigonometric(), x, jac);
+        REQUIRE_MATRIX_APPROX(jacExp, jac, eps);
+    }
+
+    SECTION("sparse jacobian")
+    {
+        Eigen::VectorXd x(10);
+        for(long int i = 0; i < x.size(); ++i)
+            x(i) = 0.1 * i;
+
+        Eigen::MatrixXd jacExp(10, 10);
+        jacExp.setZero();
+        for(long int i = 0; i < x.size(); ++i)
+        {
+            jacExp(i, i) = 6 * x(i);
+            if(i > 0)
+                jacExp(i, i - 1) = -1;
+            if(i + 1 < x.size())
+                jacExp(i, i + 1) = std::exp(x(i + 1));
+        }
+
+        // three colors suffice for a tridiagonal pattern
+        Eigen::SparseMatrix<double> jac;
+        fwd::sparseJacobian<3>(Tridiagonal(), x, jac);
+        REQUIRE(jac.nonZeros() == 28);
+        REQUIRE_MATRIX_APPROX(jacExp, Eigen::MatrixXd(jac), eps);
+
+        fwd::sparseJacobian<fwd::Dynamic>(Tridiagonal(), x, jac);
+        REQUIRE_MATRIX_APPROX(jacExp, Eigen::MatrixXd(jac), eps);
+    }
+
+    SECTION("parallel jacobian")
+    {
+        Eigen::VectorXd x(37);
+        for(long int i = 0; i < x.size(); ++i)
+            x(i) = 0.05 * i - 0.4;
+
+        Eigen::MatrixXd jacExp(38, 37);
+        fwd::jacobian(Trigonometric(), x, jacExp);
+
+        ThreadPool pool(4);
+        Eigen::MatrixXd jac(38, 37);
+        fwd::parallelJacobian<3>(Trigonometric(), x, jac, pool);
+        REQUIRE_MATRIX_APPROX(jacExp, jac, eps);
+        fwd::parallelJacobian(Trigonometric(), x, jac);
+        REQUIRE_MATRIX_APPROX(jacExp, jac, eps);
+        fwd::parallelJacobian<fwd::Dynamic>(Trigonometric(), x, jac, pool);
+        REQUIRE_MATRIX_APPROX(jacExp, jac, eps);
+    }
+
+    SECTION("thread pool")
+    {
+        ThreadPool pool(3);
+
+        // every item is processed exactly once, whoever takes it
+        std::vector<int> calls(100, 0);
+        pool.parallelFor(calls.size(), [&](const std::size_t item, const std::size_t)
+        {
+            ++calls[item];
+        });
+        REQUIRE(std::count(calls.begin(), calls.end(), 1) == 100);
+
+        pool.parallelFor(0, [](const std::size_t, const std::size_t) { });
+
+        REQUIRE_THROWS_AS(pool.parallelFor(10, [](const std::size_t item, const std::size_t)
+        {
+            if(item == 7)
+                throw std::runtime_error("failed");
+        }), std::runtime_error);
+    }
 }
@@ -6,6 +6,7 @@
 
 #include <catch2/catch.hpp>
 #include <adcpp/adcpp.hpp>
+#include <vector>
 
 using namespace adcpp;
 
@@ -55,6 +56,53 @@ TEMPLATE_TEST_CASE("forward algorithmic differentiation", "[forward]", float, do
         REQUIRE(copy == fromScalar);
     }
 
+    SECTION("custom function")
+    {
+        // polar to cartesian coordinates with a hand coded Jacobian
+        const auto polar = [](const Scalar *x, Scalar *y, Scalar *jacobian)
+        {
+            y[0] = x[0] * std::cos(x[1]);
+            y[1] = x[0] * std::sin(x[1]);
+            jacobian[0] = std::cos(x[1]);
+            jacobian[1] = -x[0] * std::sin(x[1]);
+            jacobian[2] = std::sin(x[1]);
+            jacobian[3] = x[0] * std::cos(x[1]);
+        };
+        const auto polarValue = [](const Scalar *x, Scalar *y)
+        {
+            y[0] = x[0] * std::cos(x[1]);
+            y[1] = x[0] * std::sin(x[1]);
+        };
+        const auto polarAdjoint = [](const Scalar *x, const Scalar *, const Scalar *ya, Scalar *xa)
+        {
+            xa[0] = std::cos(x[1]) * ya[0] + std::sin(x[1]) * ya[1];
+            xa[1] = -x[0] * std::sin(x[1]) * ya[0] + x[0] * std::cos(x[1]) * ya[1];
+        };
+
+        const Scalar r = 2;
+        const Scalar phi = Scalar(0.5);
+        const std::vector<ADScalar> inputs{ADScalar(r, 1), ADScalar(phi, Scalar(-0.5))};
+
+        auto outputs = fwd::customFunction(polar, inputs, 2);
+        REQUIRE(outputs.size() == 2);
+        REQUIRE(Approx(r * std::cos(phi)).margin(eps) == outputs[0].value());
+        REQUIRE(Approx(r * std::sin(phi)).margin(eps) == outputs[1].value());
+        REQUIRE(Approx(std::cos(phi) + Scalar(0.5) * r * std::sin(phi)).margin(eps) == outputs[0].derivative());
+        REQUIRE(Approx(std::sin(phi) - Scalar(0.5) * r * std::cos(phi)).margin(eps) == outputs[1].derivative());
+
+        outputs = fwd::customFunction(polarValue, polarAdjoint, inputs, 2);
+        REQUIRE(Approx(r * std::cos(phi)).margin(eps) == outputs[0].value());
+        REQUIRE(Approx(std::cos(phi) + Scalar(0.5) * r * std::sin(phi)).margin(eps) == outputs[0].derivative());
+        REQUIRE(Approx(std::sin(phi) - Scalar(0.5) * r * std::cos(phi)).margin(eps) == outputs[1].derivative());
+
+        // dynamic tangents of constants are empty
+        using ADScalarX = fwd::Number<Scalar, fwd::Dynamic>;
+        const std::vector<ADScalarX> inputsX{ADScalarX(r), ADScalarX(phi, fwd::Tangent<Scalar, fwd::Dynamic>::Unit(2, 1))};
+        const auto outputsX = fwd::customFunction(polar, inputsX, 2);
+        REQUIRE(Approx(-r * std::sin(phi)).margin(eps) == outputsX[0].derivative(1));
+        REQUIRE(Approx(0).margin(eps) == outputsX[0].derivative(0));
+    }
+
     SECTION("add constant")
     {
         ADScalar x(3, 1);
@@ -417,3 +465,111 @@ TEMPLATE_TEST_CASE("forward algorithmic differentiation", "[forward]", float, do
         REQUIRE(Approx(gradYExp).margin(eps) == fy.derivative());
     }
 }
+
+TEMPLATE_TEST_CASE("forward algorithmic differentiation in multiple directions", "[forward]", float, double)
+{
+    using Scalar = TestType;
+    using ADScalar = fwd::Number<Scalar, 3>;
+    using ADScalarX = fwd::Number<Scalar, fwd::Dynamic>;
+    Scalar eps = static_cast<Scalar>(1e-5);
+
+    SECTION("construct")
+    {
+        const auto defaultValue = ADScalar();
+        REQUIRE(Scalar{0} == defaultValue.value());
+        REQUIRE(3 == defaultValue.tangent().size());
+        REQUIRE(Scalar{0} == defaultValue.derivative(0));
+        REQUIRE(Scalar{0} == defaultValue.derivative(2));
+
+        const auto unit = ADScalar(Scalar{2}, ADScalar::Derivative::Unit(1));
+        REQUIRE(Scalar{2} == unit.value());
+        REQUIRE(Scalar{0} == unit.derivative(0));
+        REQUIRE(Scalar{1} == unit.derivative(1));
+        REQUIRE(Scalar{0} == unit.derivative(2));
+
+        const auto constant = ADScalarX(Scalar{2});
+        REQUIRE(0 == constant.tangent().size());
+        REQUIRE(Scalar{0} == constant.derivative(1));
+
+        const auto unitX = ADScalarX(Scalar{2}, ADScalarX::Derivative::Unit(4, 3));
+        REQUIRE(4 == unitX.tangent().size());
+        REQUIRE(Scalar{0} == unitX.derivative(0));
+        REQUIRE(Scalar{1} == unitX.derivative(3));
+    }
+
+    SECTION("gradient in one pass")
+    {
+        ADScalar x(3, ADScalar::Derivative::Unit(0));
+        ADScalar y(2, ADScalar::Derivative::Unit(1));
+        ADScalar z(static_cast<Scalar>(0.5), ADScalar::Derivative::Unit(2));
+
+        Scalar valExp = std::exp(x.value() * y.value()) / z.value() + std::sin(z.value());
+        Scalar gradXExp = y.value() * std::exp(x.value() * y.value()) / z.value();
+        Scalar gradYExp = x.value() * std::exp(x.value() * y.value()) / z.value();
+        Scalar gradZExp = -std::exp(x.value() * y.value()) / (z.value() * z.value()) + std::cos(z.value());
+
+        ADScalar f = fwd::exp(x * y) / z + fwd::sin(z);
+
+        REQUIRE(Approx(valExp).epsilon(eps) == f.value());
+        REQUIRE(Approx(gradXExp).epsilon(eps) == f.derivative(0));
+        REQUIRE(Approx(gradYExp).epsilon(eps) == f.derivative(1));
+        REQUIRE(Approx(gradZExp).epsilon(eps) == f.derivative(2));
+    }
+
+    SECTION("gradient in one pass with dynamic directions")
+    {
+        ADScalarX x(3, ADScalarX::Derivative::Unit(2, 0));
+        ADScalarX y(2, ADScalarX::Derivative::Unit(2, 1));
+
+        Scalar valExp = std::sqrt(x.value() * x.value() + y.value() * y.value()) - 2;
+        Scalar gradXExp = x.value() / (valExp + 2);
+        Scalar gradYExp = y.value() / (valExp + 2);
+
+        ADScalarX f = fwd::sqrt(x * x + y * y) - ADScalarX(2);
+
+        REQUIRE(2 == f.tangent().size());
+        REQUIRE(Approx(valExp).epsilon(eps) == f.value());
+        REQUIRE(Approx(gradXExp).epsilon(eps) == f.derivative(0));
+        REQUIRE(Approx(gradYExp).epsilon(eps) == f.derivative(1));
+    }
+
+    SECTION("agrees with single direction")
+    {
+        ADScalar x(static_cast<Scalar>(0.3), ADScalar::Derivative::Unit(0));
+        ADScalar y(static_cast<Scalar>(0.7), ADScalar::Derivative::Unit(1));
+        ADScalar f = fwd::atan2(y, x) * fwd::log(y) + fwd::pow(x, 3) - fwd::tan(x) / fwd::acos(y);
+
+        fwd::Number<Scalar> x0(static_cast<Scalar>(0.3), 1);
+        fwd::Number<Scalar> y0(static_cast<Scalar>(0.7), 0);
+        fwd::Number<Scalar> fx = fwd::atan2(y0, x0) * fwd::log(y0) + fwd::pow(x0, 3) - fwd::tan(x0) / fwd::acos(y0);
+
+        fwd::Number<Scalar> x1(static_cast<Scalar>(0.3), 0);
+        fwd::Number<Scalar> y1(static_cast<Scalar>(0.7), 1);
+        fwd::Number<Scalar> fy = fwd::atan2(y1, x1) * fwd::log(y1) + fwd::pow(x1, 3) - fwd::tan(x1) / fwd::acos(y1);
+
+        REQUIRE(Approx(fx.value()).epsilon(eps) == f.value());
+        REQUIRE(Approx(fx.derivative()).epsilon(eps) == f.derivative(0));
+        REQUIRE(Approx(fy.derivative()).epsilon(eps) == f.derivative(1));
+        REQUIRE(Scalar{0} == f.derivative(2));
+    }
+
+    SECTION("many directions")
+    {
+        // more directions than fit into the widest SIMD register, so both the
+        // vectorized loops and their remainders are exercised
+        using ADScalarN = fwd::Number<Scalar, 19>;
+        typename ADScalarN::Derivative seed;
+        for(std::size_t i = 0; i < seed.size(); ++i)
+            seed[i] = static_cast<Scalar>(i) - 9;
+
+        ADScalarN x(static_cast<Scalar>(0.4), seed);
+        ADScalarN f = fwd::abs(-fwd::exp(x) * x / fwd::cos(x) - x);
+
+        fwd::Number<Scalar> x0(static_cast<Scalar>(0.4), 1);
+        fwd::Number<Scalar> f0 = fwd::abs(-fwd::exp(x0) * x0 / fwd::cos(x0) - x0);
+
+        REQUIRE(Approx(f0.value()).epsilon(eps) == f.value());
+        for(std::size_t i = 0; i < seed.size(); ++i)
+            REQUIRE(Approx(std::abs(f0.derivative() * seed[i])).epsilon(eps) == f.derivative(i));
+    }
+}
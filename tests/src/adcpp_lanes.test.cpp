@@ -0,0 +1,122 @@
+/* adcpp_lanes.test.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: Fabian Meyer
+ */
+
+#include <catch2/catch.hpp>
+#include <adcpp/adcpp.hpp>
+
+using namespace adcpp;
+
+TEMPLATE_TEST_CASE("lanes", "[lanes]", float, double)
+{
+    using Scalar = TestType;
+    using LaneScalar = Lanes<Scalar, 8>;
+    Scalar eps = static_cast<Scalar>(1e-6);
+
+    const Scalar values[] = {
+        static_cast<Scalar>(-7.3), static_cast<Scalar>(-1.2), static_cast<Scalar>(-0.4), static_cast<Scalar>(0),
+        static_cast<Scalar>(0.3), static_cast<Scalar>(1.7), static_cast<Scalar>(5.5), static_cast<Scalar>(31.9)};
+    const auto x = LaneScalar::load(values);
+
+    SECTION("arithmetic")
+    {
+        const LaneScalar f = (x * x - x) / Scalar{2} + Scalar{1};
+        for(std::size_t i = 0; i < x.size(); ++i)
+            REQUIRE(Approx((values[i] * values[i] - values[i]) / 2 + 1).epsilon(eps) == f[i]);
+    }
+
+    SECTION("elementary functions")
+    {
+        const LaneScalar fsin = sin(x);
+        const LaneScalar fcos = cos(x);
+        const LaneScalar fexp = exp(x / Scalar{4});
+        const LaneScalar flog = log(abs(x) + Scalar{1});
+        const LaneScalar fpow = pow(abs(x) + Scalar{1}, 2.5);
+        const LaneScalar fsqrt = pow(abs(x), 0.5);
+        const LaneScalar fcube = pow(x, 3);
+
+        for(std::size_t i = 0; i < x.size(); ++i)
+        {
+            REQUIRE(Approx(std::sin(values[i])).margin(eps) == fsin[i]);
+            REQUIRE(Approx(std::cos(values[i])).margin(eps) == fcos[i]);
+            REQUIRE(Approx(std::exp(values[i] / 4)).epsilon(eps) == fexp[i]);
+            REQUIRE(Approx(std::log(std::abs(values[i]) + 1)).margin(eps) == flog[i]);
+            REQUIRE(Approx(std::pow(std::abs(values[i]) + 1, Scalar{2.5})).epsilon(eps) == fpow[i]);
+            REQUIRE(Approx(std::sqrt(std::abs(values[i]))).margin(eps) == fsqrt[i]);
+            REQUIRE(Approx(values[i] * values[i] * values[i]).epsilon(eps) == fcube[i]);
+        }
+    }
+
+    SECTION("special values")
+    {
+        const Scalar inf = std::numeric_limits<Scalar>::infinity();
+        const auto large = LaneScalar(Scalar{1000});
+        REQUIRE(all(exp(large) == LaneScalar(inf)));
+        REQUIRE(all(exp(-large) == LaneScalar(0)));
+        REQUIRE(all(log(LaneScalar(0)) == LaneScalar(-inf)));
+        REQUIRE(all(log(LaneScalar(inf)) == LaneScalar(inf)));
+        REQUIRE(!any(isfinite(log(LaneScalar(-1)))));
+        REQUIRE(Approx(std::log(std::numeric_limits<Scalar>::denorm_min())).epsilon(eps) ==
+            log(LaneScalar(std::numeric_limits<Scalar>::denorm_min()))[0]);
+    }
+
+    SECTION("comparison")
+    {
+        const auto mask = x < LaneScalar(0);
+        REQUIRE(any(mask));
+        REQUIRE(!all(mask));
+
+        const LaneScalar f = select(mask, -x, x);
+        for(std::size_t i = 0; i < x.size(); ++i)
+            REQUIRE(std::abs(values[i]) == f[i]);
+    }
+
+    SECTION("forward mode over lanes")
+    {
+        using ADScalar = fwd::Number<LaneScalar>;
+        const ADScalar y(x, LaneScalar(1));
+
+        const ADScalar f = fwd::exp(fwd::sin(y) / ADScalar(2)) * fwd::pow(y, 2) + fwd::log(fwd::abs2(y) + ADScalar(1));
+
+        for(std::size_t i = 0; i < x.size(); ++i)
+        {
+            fwd::Number<Scalar> yi(values[i], 1);
+            fwd::Number<Scalar> fi = fwd::exp(fwd::sin(yi) / fwd::Number<Scalar>(2)) * fwd::pow(yi, 2) +
+                fwd::log(fwd::abs2(yi) + fwd::Number<Scalar>(1));
+
+            REQUIRE(Approx(fi.value()).epsilon(eps) == f.value()[i]);
+            REQUIRE(Approx(fi.derivative()).epsilon(eps) == f.derivative()[i]);
+        }
+    }
+
+    SECTION("forward mode fractional power")
+    {
+        using ADScalar = fwd::Number<LaneScalar>;
+        const ADScalar y(abs(x) + Scalar{1}, LaneScalar(1));
+
+        const ADScalar f = fwd::pow(y, 2.5);
+        for(std::size_t i = 0; i < x.size(); ++i)
+        {
+            const Scalar yi = std::abs(values[i]) + 1;
+            REQUIRE(Approx(std::pow(yi, Scalar{2.5})).epsilon(eps) == f.value()[i]);
+            REQUIRE(Approx(Scalar{2.5} * std::pow(yi, Scalar{1.5})).epsilon(eps) == f.derivative()[i]);
+        }
+    }
+
+    SECTION("forward mode comparison")
+    {
+        using ADScalar = fwd::Number<LaneScalar>;
+        const ADScalar y(x, LaneScalar(1));
+        const ADScalar zero(LaneScalar(0));
+
+        const ADScalar f = fwd::select(y < zero, -y * y, y * y);
+        for(std::size_t i = 0; i < x.size(); ++i)
+        {
+            const Scalar sign = values[i] < 0 ? Scalar{-1} : Scalar{1};
+            REQUIRE(Approx(sign * values[i] * values[i]).epsilon(eps) == f.value()[i]);
+            REQUIRE(Approx(sign * 2 * values[i]).epsilon(eps) == f.derivative()[i]);
+        }
+    }
+}